@@ -0,0 +1,177 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: matrix benchmark, blocked and multithreaded operator*, trans
+*              and inverse against the plain loops they replaced
+*/
+#include "matrix.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+/**
+* @brief reference product, the plain triple loop
+* @param lhs [in] left matrix
+* @param rhs [in] right matrix
+* @return lhs * rhs
+*/
+static Matrix naiveMul(const Matrix& lhs, const Matrix& rhs)
+{
+	Matrix m(lhs.rows(), rhs.cols());
+	for (int i = 0; i < m.rows(); i++)
+	{
+		for (int j = 0; j < m.cols(); j++)
+		{
+			double sum = 0.0;
+			for (int k = 0; k < lhs.cols(); k++)
+			{
+				sum += lhs[i][k] * rhs[k][j];
+			}
+			m[i][j] = sum;
+		}
+	}
+	return m;
+}
+
+/**
+* @brief reference transpose, element by element
+* @param m [in] matrix
+* @return transposed matrix
+*/
+static Matrix naiveTrans(const Matrix& m)
+{
+	Matrix ret(m.cols(), m.rows());
+	for (int i = 0; i < ret.rows(); i++)
+	{
+		for (int j = 0; j < ret.cols(); j++)
+		{
+			ret[i][j] = m[j][i];
+		}
+	}
+	return ret;
+}
+
+/**
+* @brief reference inverse, single threaded Gauss-Jordan
+* @param m [in] square matrix
+* @return inverse, empty if singular
+*/
+static Matrix naiveInverse(const Matrix& m)
+{
+	int n = m.rows();
+	Matrix A(m);
+	Matrix ret(n, n);
+	for (int i = 0; i < n; i++)
+	{
+		ret[i][i] = 1.0;
+	}
+	for (int j = 0; j < n; j++)
+	{
+		int p = j;
+		for (int i = j + 1; i < n; i++)
+		{
+			if (fabs(A[i][j]) > fabs(A[p][j]))
+			{
+				p = i;
+			}
+		}
+		if (fabs(A[p][j]) < 1e-20)
+		{
+			return Matrix();
+		}
+		A.swap_row(j, p);
+		ret.swap_row(j, p);
+		double d = A[j][j];
+		for (int k = j; k < n; k++) A[j][k] /= d;
+		for (int k = 0; k < n; k++) ret[j][k] /= d;
+		for (int i = 0; i < n; i++)
+		{
+			if (i == j)
+			{
+				continue;
+			}
+			double q = A[i][j];
+			for (int k = j; k < n; k++) A[i][k] -= q * A[j][k];
+			for (int k = 0; k < n; k++) ret[i][k] -= q * ret[j][k];
+		}
+	}
+	return ret;
+}
+
+/**
+* @brief best wall time of a few runs
+* @param fn [in] function to time
+* @return best time, in second
+*/
+static double bestTime(const std::function<void()>& fn)
+{
+	double best = 1e30;
+	for (int run = 0; run < 3; run++)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		fn();
+		auto t1 = std::chrono::steady_clock::now();
+		double t = std::chrono::duration<double>(t1 - t0).count();
+		best = (t < best) ? t : best;
+	}
+	return best;
+}
+
+static Matrix randomMatrix(int rows, int cols, unsigned int seed)
+{
+	Matrix m(rows, cols);
+	srand(seed);
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < cols; j++)
+		{
+			m[i][j] = double(rand()) / RAND_MAX - 0.5;
+		}
+		m[i][i < cols ? i : 0] += cols;		/* diagonally dominant, well conditioned */
+	}
+	return m;
+}
+
+/**
+* usage: MatrixBench [max size]
+* prints time and GFLOP/s of the reference and the library version of
+* each op for sizes 64 ... max size, and the largest difference between them
+*/
+int main(int argc, char* argv[])
+{
+	int maxSize = (argc > 1) ? atoi(argv[1]) : 1024;
+
+	printf("%-8s %6s %12s %12s %10s %10s %8s %10s\n",
+		"op", "n", "ref ms", "lib ms", "ref GF/s", "lib GF/s", "speedup", "max diff");
+	for (int n = 64; n <= maxSize; n *= 2)
+	{
+		Matrix A = randomMatrix(n, n, 1);
+		Matrix B = randomMatrix(n, n, 2);
+		Matrix refC, libC;
+
+		/* product, 2n^3 flops */
+		double flops = 2.0 * n * n * n;
+		double tRef = bestTime([&] { refC = naiveMul(A, B); });
+		double tLib = bestTime([&] { libC = A * B; });
+		printf("%-8s %6d %12.3f %12.3f %10.2f %10.2f %8.2f %10.3g\n", "mul", n,
+			tRef * 1e3, tLib * 1e3, flops / tRef * 1e-9, flops / tLib * 1e-9, tRef / tLib, max(abs(refC - libC)));
+
+		/* transpose, no flops, GF/s column shows giga elements/s */
+		double elems = double(n) * n;
+		tRef = bestTime([&] { refC = naiveTrans(A); });
+		tLib = bestTime([&] { libC = trans(A); });
+		printf("%-8s %6d %12.3f %12.3f %10.2f %10.2f %8.2f %10.3g\n", "trans", n,
+			tRef * 1e3, tLib * 1e3, elems / tRef * 1e-9, elems / tLib * 1e-9, tRef / tLib, max(abs(refC - libC)));
+
+		/* Gauss-Jordan inverse, 2n^3 flops */
+		tRef = bestTime([&] { refC = naiveInverse(A); });
+		tLib = bestTime([&] { libC = inverse(A); });
+		printf("%-8s %6d %12.3f %12.3f %10.2f %10.2f %8.2f %10.3g\n", "inverse", n,
+			tRef * 1e3, tLib * 1e3, flops / tRef * 1e-9, flops / tLib * 1e-9, tRef / tLib, max(abs(refC - libC)));
+	}
+	return 0;
+}
@@ -14,6 +14,18 @@ typedef struct _CFG_CMT
         _show_offset_path = "NULL";
         _curve_size = 1001;
         _curve_step = 0.1;
+        _curve_tolerance = 0.0;
+        _kb_order = 5;
+        _remap_type = "NULL";
+        _remap_path = "NULL";
+        _remap_fov = 90.0;
+        _remap_threads = 0;
+        _remap_radial = "false";
+        _save_format = "TEXT";
+        _batch_input = "NULL";
+        _batch_output = "NULL";
+        _batch_report = "NULL";
+        _batch_threads = 0;
     }
     string _help;
     string _path_to_ori_model;
@@ -23,8 +35,49 @@ typedef struct _CFG_CMT
     string _show_offset_path;
     int _curve_size;
     float _curve_step;
+    float _curve_tolerance;
+    int _kb_order;
+    string _remap_type;
+    string _remap_path;
+    float _remap_fov;
+    int _remap_threads;
+    string _remap_radial;
+    string _save_format;
+    string _batch_input;
+    string _batch_output;
+    string _batch_report;
+    int _batch_threads;
 }CFG_CMT;
 
+/**
+* everything one conversion reads and writes, conversions on different
+* contexts share nothing and may run on different threads
+* the context owns both models and releases them when it goes away
+*/
+typedef struct _CONVERSION_CONTEXT
+{
+    _CONVERSION_CONTEXT() : mode(UNIVERSAL), model(NULL) {}
+    ~_CONVERSION_CONTEXT();
+    _CONVERSION_CONTEXT(const _CONVERSION_CONTEXT&) = delete;
+    _CONVERSION_CONTEXT& operator=(const _CONVERSION_CONTEXT&) = delete;
+    CFG_CMT cfg;            /* config terms */
+    CameraModel mode;       /* target camera model type */
+    CamInt oriCam;          /* original camera model */
+    void* model;            /* transfered model, of type mode */
+}ConversionContext;
+
+/* result of converting one model in batch mode */
+typedef struct _BATCH_RESULT
+{
+    string inPath;          /* model to be transfered */
+    string outPath;         /* saved model */
+    CFlags status;          /* CTRUE if the model is converted and saved */
+    string message;         /* why it failed, empty on success */
+    float32_t rmsError;     /* rms radius error of the transfered model, in mm */
+    float32_t maxError;     /* max radius error of the transfered model, in mm */
+    double ms;              /* time spent on this model */
+}BatchResult;
+
 /**
  * @brief validate inputs
  * @param argc [in] number of input arguments 
@@ -53,28 +106,105 @@ static bool extractCfg(CFG_CMT &cfg, char** argv);
 */
 static CamInt loadCamInts(const char* path);
 
+/**
+* @brief read the _DISORT curve straight into new dAngle and dRadius, the
+*        curve must have _DISORT_SIZE rows of angle and radius with the
+*        angle increasing, checked while parsing. angles on the uniform
+*        grid of _DISORT_STEP are dropped
+* @param cfg [in]     loaded camera model config
+* @param cam [in/out] camera model, dStep and dCurveSize are read
+* @return success flag
+*/
+static CFlags loadDisortCurve(CONFIG& cfg, CamInt* cam);
+
 /**
 * @brief transfer camera model
-* @param type [in] target camera model type, align with [TargetCameraModel]
-* @param cam  [in] origin cam ints
+* @param type      [in] target camera model type, align with [TargetCameraModel]
+* @param cam       [in] origin cam ints
+* @param tolerance [in] max radius error of a resampled UNIVERSAL curve, in mm,
+*                       0 keeps every point
+* @param kbOrder   [in] number of coef of a KANNALA_BRANDT target
 * @return pointer to result
 */
-static void* modelTransfer(int32_t type, CamInt* cam);
+static void* modelTransfer(int32_t type, CamInt* cam, float32_t tolerance, int32_t kbOrder);
 
 /**
-* @brief save calculated model
-* @param path  [in] save path
+* @brief save calculated model to _path_to_save_model
+* @param ctx [in] conversion context, with the calculated model
+* @return success flag
+*/
+static CFlags modelSave(const ConversionContext* ctx);
+
+/**
+* @brief build and save remap maps between the transfered model and a
+*        virtual pinhole camera, see _remap_* config terms, saved to _remap_path
+* @param ctx [in] conversion context, with the calculated model
+* @return void return
+*/
+static void modelRemap(const ConversionContext* ctx);
+
+/**
+* @brief release a model returned by modelTransfer, a UNIVERSAL model
+*        is a deep copy and frees its own curves
 * @param model [in] calculated model
 * @param type  [in] target camera model type, align with [TargetCameraModel]
-* @return pointer to result
+* @return void return
+*/
+static void releaseModel(void* model, int32_t type);
+
+/**
+* @brief radius error of the transfered model against the original curve,
+*        at the angles the models are fitted on
+* @param oriCam   [in]  original camera model
+* @param model    [in]  calculated model
+* @param type     [in]  target camera model type, align with [TargetCameraModel]
+* @param rmsError [out] rms radius error, in mm
+* @param maxError [out] max radius error, in mm
+* @return success flag
+*/
+static CFlags modelFitError(CamInt* oriCam, void* model, int32_t type, float32_t* rmsError, float32_t* maxError);
+
+/**
+* @brief list the models of a batch, _batch_input is either a directory,
+*        every regular file in it is a model, or a manifest, one model
+*        path per line, relative paths start at the manifest's directory
+* @param input  [in]  directory or manifest
+* @param models [out] model paths, sorted for a directory
+* @return success flag
+*/
+static bool listBatchModels(const string& input, vector<string>& models);
+
+/**
+* @brief load, transfer and save one model of a batch
+* @param batch  [in]     batch context, config and target type are read
+* @param result [in/out] inPath and outPath are read, the rest is filled
+* @return void return
+*/
+static void convertModel(const ConversionContext* batch, BatchResult* result);
+
+/**
+* @brief convert every model of _batch_input on a thread pool, save them
+*        in _batch_output and write the summary to _batch_report
+* @param batch [in] batch context, config and target type are read
+* @return number of models failed, -1 if the batch could not run or the
+*         report could not be saved
+*/
+static int32_t modelBatch(const ConversionContext* batch);
+
+/**
+* @brief save the summary of a batch to _batch_report, one line per model
+* @param batch   [in] batch context, config is read
+* @param results [in] results of all models, in input order
+* @param ms      [in] time spent on the whole batch
+* @param threads [in] number of threads converting models
+* @return success flag
 */
-static void modelSave(const char* path, void*model, int32_t type);
+static bool saveBatchReport(const ConversionContext* batch, const vector<BatchResult>& results, double ms, int32_t threads);
 
 /**
- * @brief show model disortion curves  
- * @param oriCam [in] original camera model
- * @param tgtCam [in] transfered camera model
+ * @brief show model disortion curves, the plot is saved to _show_offset_path
+ * @param ctx [in] conversion context, with the original and the calculated model
  * @return void return
  */
-static void modelShow(CamInt* oriCam, void* tgtCam);
+static void modelShow(const ConversionContext* ctx);
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: owning float buffer for camera model curves, the memory
+*              comes from a size-class pool shared by all threads, so
+*              converting model after model reuses the same buffers
+*/
+#ifndef __DEFINE_CURVE_BUFFER__
+#define __DEFINE_CURVE_BUFFER__
+#include <cstddef>
+
+class CurveBuffer
+{
+public:
+	CurveBuffer() : ptr(NULL), count(0), capacity(0) {}
+
+	/**
+	* Constructor, allocate n elements, contents are undefined
+	* @param n [in] number of elements
+	*/
+	explicit CurveBuffer(size_t n) : ptr(NULL), count(0), capacity(0) { allocate(n); }
+
+	/**
+	* DeConstructor, return the buffer to the pool
+	*/
+	~CurveBuffer() { reset(); }
+
+	CurveBuffer(const CurveBuffer& b);				/* deep copy */
+	CurveBuffer& operator=(const CurveBuffer& b);	/* deep copy */
+	CurveBuffer(CurveBuffer&& b) noexcept;
+	CurveBuffer& operator=(CurveBuffer&& b) noexcept;
+
+	/**
+	* Hold n elements, contents are undefined, the current buffer is
+	* kept when it is large enough
+	* @param n [in] number of elements
+	* @return void return
+	*/
+	void allocate(size_t n);
+
+	/**
+	* Return the buffer to the pool, empty() afterwards
+	* @return void return
+	*/
+	void reset();
+
+	float* data() { return ptr; }
+	const float* data() const { return ptr; }
+	size_t size() const { return count; }
+	bool empty() const { return 0 == count; }
+	float& operator[](size_t idx) { return ptr[idx]; }
+	const float& operator[](size_t idx) const { return ptr[idx]; }
+
+private:
+	float*	ptr;
+	size_t	count;		/* elements in use */
+	size_t	capacity;	/* elements allocated, the size class */
+};
+#endif
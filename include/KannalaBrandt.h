@@ -1,13 +1,19 @@
-/**
-* Copyright: Yihui Yu. All rights reserved.
-*
-* Author: Yihui Yu
-* Date: 2020 - 02 - 06
-* Description: fit camera model KannalaBrandt
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: fit camera model KannalaBrandt
 */
 #ifndef __DEFINE_KANNALA_BRANDT__
 #define __DEFINE_KANNALA_BRANDT__
 #include "common.h"
+#include "smatrix.h"
+#include <array>
+#include <type_traits>
+
+#define KB_MAX_ORDER	(12)		/* max number of coef supported by batch kernels */
+#define KB_NEWTON_ITER	(8)			/* max newton iterations when unprojecting */
 
 /**
 * r = k1 * theta + k2 * theta^3 + k3 * theta^5 + ... + ki * theta^(2*i-1)
@@ -26,6 +32,112 @@ typedef struct _CamIntKannalaBrandt
 	float32_t mv;				/* number of pixels per mm, v */
 }CamIntKannalaBrandt;
 
+/**
+* KannalaBrandt model with the order fixed at compile time, coef live
+* in place and radius() is a fully unrolled Horner polynomial
+* build one from CamIntKannalaBrandt inside dispatchKannalaBrandt
+*/
+template <int32_t Order>
+struct KannalaBrandt
+{
+	static_assert((Order >= 1) && (Order <= KB_MAX_ORDER), "KannalaBrandt order out of range");
+	static constexpr int32_t order = Order;
+
+	std::array<float32_t, Order> k;	/* coef, first one is fixed to 1 */
+	float32_t cu;					/* optic center, u */
+	float32_t cv;					/* optic center, v */
+	float32_t mu;					/* number of pixels per mm, u */
+	float32_t mv;					/* number of pixels per mm, v */
+
+	/**
+	* @brief copy a runtime model, model->k shall hold Order coef
+	* @param model [in] model parameters
+	*/
+	explicit KannalaBrandt(const CamIntKannalaBrandt* model)
+		: cu(model->cu), cv(model->cv), mu(model->mu), mv(model->mv)
+	{
+		for (int32_t kIdx = 0; kIdx < Order; kIdx++)
+		{
+			k[kIdx] = model->k[kIdx];
+		}
+	}
+
+	/**
+	* @brief k1 + k2 * t + ... + ki * t^(i-1), unrolled at compile time
+	* @param t [in] theta^2
+	* @return polynomial value
+	*/
+	template <int32_t Idx = 0>
+	constexpr float32_t poly(float32_t t) const
+	{
+		if constexpr (Idx == Order - 1)
+		{
+			return k[Idx];
+		}
+		else
+		{
+			return poly<Idx + 1>(t)*t + k[Idx];
+		}
+	}
+
+	/**
+	* @brief r = k1 * theta + k2 * theta^3 + ... + ki * theta^(2*i-1)
+	* @param theta [in] angle, in rad
+	* @return radius
+	*/
+	constexpr float32_t radius(float32_t theta) const
+	{
+		return poly(theta*theta)*theta;
+	}
+};
+
+/**
+* @brief call func(std::integral_constant<int32_t, order>()) for a runtime
+*        order, so func can be instantiated per order
+* @param order [in] number of coef
+* @param func  [in] generic callable taking the order as integral constant
+* @return success flag, CFALSE if the order is not in [1, KB_MAX_ORDER]
+*/
+template <typename Func>
+CFlags dispatchKannalaBrandtOrder(int32_t order, Func&& func)
+{
+	switch (order)
+	{
+	case 1: func(std::integral_constant<int32_t, 1>()); break;
+	case 2: func(std::integral_constant<int32_t, 2>()); break;
+	case 3: func(std::integral_constant<int32_t, 3>()); break;
+	case 4: func(std::integral_constant<int32_t, 4>()); break;
+	case 5: func(std::integral_constant<int32_t, 5>()); break;
+	case 6: func(std::integral_constant<int32_t, 6>()); break;
+	case 7: func(std::integral_constant<int32_t, 7>()); break;
+	case 8: func(std::integral_constant<int32_t, 8>()); break;
+	case 9: func(std::integral_constant<int32_t, 9>()); break;
+	case 10: func(std::integral_constant<int32_t, 10>()); break;
+	case 11: func(std::integral_constant<int32_t, 11>()); break;
+	case 12: func(std::integral_constant<int32_t, 12>()); break;
+	default:
+		CLOG_E("Unsupported KannalaBrandt order %d, should be in [1, %d]\n", order, KB_MAX_ORDER);
+		return CFALSE;
+	}
+	return CTRUE;
+}
+
+/**
+* @brief call func(KannalaBrandt<order>) for the order of a runtime model,
+*        so hot loops inside func run on the compile time specialization
+* @param model [in] model parameters, order is k.size()
+* @param func  [in] generic callable taking a KannalaBrandt<N>
+* @return success flag, CFALSE if the order is not in [1, KB_MAX_ORDER]
+*/
+template <typename Func>
+CFlags dispatchKannalaBrandt(const CamIntKannalaBrandt* model, Func&& func)
+{
+	return dispatchKannalaBrandtOrder(int32_t(model->k.size()), [&](auto order)
+	{
+		func(KannalaBrandt<decltype(order)::value>(model));
+	});
+}
+
 /**
 * @brief fit KannalaBrandt model
 * r = k1 * theta + k2 * theta^3 + k3 * theta^5 + ... + ki * theta^(2*i-1)
@@ -50,34 +162,50 @@ CFlags fitKannalaBrandt(CamIntKannalaBrandt* targetModel, CamInt* cam, int32_t o
 CFlags extractKannalaBrandt(CamInt* cam, CamIntKannalaBrandt* targetModel);
 
 /**
-* @brief calculate theta's power sum.
-*        this is for fitKannalaBrandt, during the lsq process
-* @param cam   [in] cam model
-* @param order [in] order of kannala brandt model
-* @return vector contains power sum from order 6 to 4m+2, where m is kannala brandt order
+* @brief project 3D points to pixels with KannalaBrandt model, in batch
+*        theta = atan2(sqrt(x^2 + y^2), z), r = k1 * theta + ... + ki * theta^(2*i-1)
+*        u = cu + mu * r * x / sqrt(x^2 + y^2), same for v
+*        inputs and outputs are SoA arrays of n elements, evaluated with
+*        SIMD Horner kernels (AVX2/SSE2, scalar fallback)
+* @param model [in]  model parameters
+* @param x     [in]  point x
+* @param y     [in]  point y
+* @param z     [in]  point z, optic axis
+* @param u     [out] pixel u
+* @param v     [out] pixel v
+* @param n     [in]  number of points
+* @return success flag
 */
-static std::vector<float32_t> thetaPowerSum(CamInt* cam, int32_t order);
+CFlags projectKannalaBrandt(CamIntKannalaBrandt* model, const float32_t* x, const float32_t* y, const float32_t* z,
+	float32_t* u, float32_t* v, int32_t n);
 
 /**
-* @brief calculate radius*theta's power sum.
-*        this is for fitKannalaBrandt, during the lsq process
-* @param cam   [in] cam model
-* @param order [in] order of kannala brandt model
-* @return vector contains power sum from order 3 to 2m+1, where m is kannala brandt order
-*/
-static std::vector<float32_t> radiusThetaPowerSum(CamInt* cam, int32_t order);
-/**
-* @brief Construct matrix A to solve AK=B, for fitKannalaBrandt
-* @param thetaPower [in] calculated theta power from 3 to 4m+2, where m is kannala brandt order
-* @return calculated matrix A
+* @brief unproject pixels to unit bearing vectors with KannalaBrandt model, in batch
+*        theta is found from r by newton iterations on the Horner polynomial
+* @param model [in]  model parameters
+* @param u     [in]  pixel u
+* @param v     [in]  pixel v
+* @param x     [out] bearing x
+* @param y     [out] bearing y
+* @param z     [out] bearing z, optic axis
+* @param n     [in]  number of pixels
+* @return success flag
 */
-static Matrix constructMatrixA(std::vector<float32_t> thetaPower);
+CFlags unprojectKannalaBrandt(CamIntKannalaBrandt* model, const float32_t* u, const float32_t* v,
+	float32_t* x, float32_t* y, float32_t* z, int32_t n);
 
 /**
-* @brief Construct matrix B to solve AK=B, for fitKannalaBrandt
-* @param radiusThetaPower [in] calculated radius*theta power from 3 to 2m+1, where m is kannala brandt order
-* @param thetaPower       [in] calculated theta power from 3 to 4m+2, where m is kannala brandt order
-* @return calculated matrix B
+* @brief least squares fit of r - theta on theta^3 ... theta^(2m-1), in
+*        one pass over the curve. with x = theta / thetaMax the basis is
+*        x^3 * T_j(2x^2 - 1), T_j the chebyshev polynomials, which spans
+*        the same odd powers but keeps the normal equations well
+*        conditioned, where theta power sums break down beyond order 5.
+*        sums are in double, the solution is turned back into powers of
+*        theta at the end. this is for fitKannalaBrandt
+* @param cam [in]  cam model
+* @param K   [out] coef k2 ... km, where m is kannala brandt order
+* @return success flag, CFALSE if the curve does not fix every coef
 */
-static Matrix constructMatrixB(std::vector<float32_t> radiusThetaPower, std::vector<float32_t> thetaPower);
-#endif
\ No newline at end of file
+template <int32_t Order>
+static CFlags lsqKannalaBrandt(CamInt* cam, SMatrix<Order - 1, 1>& K);
+#endif
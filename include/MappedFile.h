@@ -0,0 +1,57 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: read-only memory mapped file, the mapping lives as long as
+*              the object, standalone so matrix.h and the loaders can use it
+*/
+#ifndef __DEFINE_MAPPED_FILE__
+#define __DEFINE_MAPPED_FILE__
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	MappedFile() : addr(NULL), length(0), opened(false) {}
+
+	/**
+	* Constructor, map a file, check isOpen() for the result
+	* @param path [in] file path
+	*/
+	explicit MappedFile(const char* path) : addr(NULL), length(0), opened(false) { open(path); }
+
+	/**
+	* DeConstructor, unmap the file
+	*/
+	~MappedFile() { close(); }
+
+	MappedFile(MappedFile&& f) noexcept;
+	MappedFile& operator=(MappedFile&& f) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	* Map the whole file read-only, pages are loaded on first touch,
+	* an empty file opens with size 0 and no data
+	* @param path [in] file path
+	* @return false if the file could not be opened or mapped
+	*/
+	bool open(const char* path);
+
+	/**
+	* Unmap the file, data() is invalid afterwards
+	* @return void return
+	*/
+	void close();
+
+	bool isOpen() const { return opened; }
+	const char* data() const { return (const char*)addr; }	/* page aligned */
+	size_t size() const { return length; }
+
+private:
+	void*	addr;
+	size_t	length;
+	bool	opened;
+};
+#endif
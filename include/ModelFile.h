@@ -0,0 +1,68 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: binary camera model file, loaded with mmap and one copy
+*/
+#ifndef __DEFINE_MODEL_FILE__
+#define __DEFINE_MODEL_FILE__
+#include "common.h"
+#include "KannalaBrandt.h"
+
+#define MODEL_FILE_MAGIC		"CAMB"			/* first 4 bytes of a binary model */
+#define MODEL_FILE_VERSION		(1)				/* current version, older versions still load */
+#define MODEL_FILE_BYTE_ORDER	(0x01020304u)	/* byte order mark, as written by the saving host */
+#define MODEL_FILE_MAX_CURVE	(1 << 26)		/* max UNIVERSAL curve size */
+
+/**
+* binary camera model file
+* header, 64 bytes, then the payload, all fields 4 bytes in the byte
+* order of the saving host, byteOrder tells a reader whether to swap
+* UNIVERSAL      param = cu, cv, c, d, e, fu, fv, dStep
+*                payload = count points of angle, radius, interleaved
+* KANNALA_BRANDT param = cu, cv, mu, mv, 0, 0, 0, 0
+*                payload = count coef, same as k
+* checksum is CRC-32 of the header, with checksum set to 0, and the payload
+*/
+typedef struct _ModelFileHeader
+{
+	char magic[4];				/* MODEL_FILE_MAGIC */
+	uint32_t version;			/* MODEL_FILE_VERSION */
+	uint32_t byteOrder;			/* MODEL_FILE_BYTE_ORDER */
+	int32_t type;				/* camera model type, align with [CameraModel] */
+	int32_t imgW;				/* image width, in pixel */
+	int32_t imgH;				/* image height, in pixel */
+	int32_t count;				/* UNIVERSAL: curve size, KANNALA_BRANDT: order */
+	uint32_t checksum;			/* CRC-32 */
+	float32_t param[8];			/* model parameters, by type */
+}ModelFileHeader;
+
+/**
+* @brief check whether a file is a binary camera model by its magic
+* @param path [in] model path
+* @return CTRUE if the file starts with MODEL_FILE_MAGIC
+*/
+CFlags isModelFile(const char* path);
+
+/**
+* @brief save camera model as binary file
+* @param path  [in] save path
+* @param model [in] camera model, CamInt or CamIntKannalaBrandt
+* @param type  [in] camera model type, align with [CameraModel]
+* @return success flag
+*/
+CFlags saveModelFile(const char* path, void* model, int32_t type);
+
+/**
+* @brief load binary camera model, the file is mapped, checked and the
+*        payload split once into angles that must be strictly increasing and
+*        radii, files from the other byte order are swapped
+* @param path    [in]  model path
+* @param type    [out] camera model type, align with [CameraModel]
+* @param cam     [out] UNIVERSAL model, dRadius and dAngle are allocated here
+* @param kbModel [out] KANNALA_BRANDT model
+* @return success flag
+*/
+CFlags loadModelFile(const char* path, int32_t* type, CamInt* cam, CamIntKannalaBrandt* kbModel);
+#endif
@@ -0,0 +1,247 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: dense remap maps between a camera model and a virtual pinhole
+*/
+#ifndef __DEFINE_REMAP__
+#define __DEFINE_REMAP__
+#include "common.h"
+#include "ThreadPool.h"
+
+#define REMAP_TILE_W	(64)			/* map tile width, a 64x64 tile of u,v fits in L1 */
+#define REMAP_TILE_H	(64)			/* map tile height */
+#define REMAP_INVALID	(-65536.0F)		/* map value of pixels without a source */
+#define REMAP_FRAC_BITS	(5)				/* fixed point bits of bilinear weights */
+#define REMAP_FRAC_ONE	(1 << REMAP_FRAC_BITS)
+#define REMAP_NO_SOURCE	(-1)			/* fixed map value of pixels without a source */
+#define REMAP_RADIAL_TOL	(0.002F)	/* radial LUT interpolation tolerance, in pixel */
+#define REMAP_RADIAL_MAX	(1 << 16)	/* radial LUT max size */
+
+enum RemapDirection
+{
+	FISHEYE_TO_PINHOLE = 0,		/* output is the pinhole image, map points into the fisheye image */
+	PINHOLE_TO_FISHEYE			/* output is the fisheye image, map points into the pinhole image */
+};
+
+enum ImageFormat
+{
+	IMAGE_GRAY = 0,				/* 8 bit, 1 channel */
+	IMAGE_RGB,					/* 8 bit, 3 channels interleaved, any channel order */
+	IMAGE_NV12					/* 8 bit Y plane + interleaved UV plane at half resolution */
+};
+
+/**
+* 8 bit image, memory is owned by the caller
+*/
+typedef struct _ImageU8
+{
+	int32_t width;				/* image width, in pixel */
+	int32_t height;				/* image height, in pixel */
+	int32_t stride;				/* bytes per row, of both planes for NV12 */
+	ImageFormat format;			/* pixel format */
+	uint8_t* data;				/* pixels, Y plane for NV12 */
+	uint8_t* dataUV;			/* UV plane for NV12, NULL otherwise */
+}ImageU8;
+
+/**
+* virtual pinhole camera
+* u = cu + fu * x / z, v = cv + fv * y / z
+*/
+typedef struct _PinholeInt
+{
+	int32_t imgW;				/* image width, in pixel */
+	int32_t imgH;				/* image height, in pixel */
+	float32_t cu;				/* optic center, u, in pixel */
+	float32_t cv;				/* optic center, v, in pixel */
+	float32_t fu;				/* focal length, u, in pixel */
+	float32_t fv;				/* focal length, v, in pixel */
+}PinholeInt;
+
+/**
+* dense remap map, for each output pixel the source pixel coordinate
+*/
+typedef struct _RemapMap
+{
+	_RemapMap()
+	{
+		width = 0;
+		height = 0;
+		mapU = NULL;
+		mapV = NULL;
+	}
+	int32_t width;				/* output image width */
+	int32_t height;				/* output image height */
+	float32_t* mapU;			/* source u of each output pixel, row major */
+	float32_t* mapV;			/* source v of each output pixel, row major */
+}RemapMap;
+
+/**
+* fixed point remap map, ready for remapImage
+* each output pixel keeps the top-left pixel of its 2x2 source footprint
+* and the bilinear fractions in 1/REMAP_FRAC_ONE
+*/
+typedef struct _RemapFixed
+{
+	_RemapFixed()
+	{
+		memset(this, 0, sizeof(_RemapFixed));
+	}
+	int32_t width;				/* output image width */
+	int32_t height;				/* output image height */
+	int32_t srcW;				/* source image width */
+	int32_t srcH;				/* source image height */
+	int32_t* xy;				/* source x | y << 16, REMAP_NO_SOURCE if outside the source */
+	uint16_t* frac;				/* fraction fx | fy << 8 */
+	int32_t* xyUV;				/* NV12 chroma map, half resolution, NULL otherwise */
+	uint16_t* fracUV;			/* NV12 chroma fractions */
+}RemapFixed;
+
+/**
+* radially symmetric remap map, both models and the pinhole are radial
+* around their optic centers so a 1D table replaces the full maps
+* in  = mIn * (out pixel - cIn)
+* src = cOut + mOut * (scale(|in|^2) * in)
+* scale is linear in lut over |in|^2, a negative scale has no source
+*/
+typedef struct _RemapRadial
+{
+	_RemapRadial()
+	{
+		memset(this, 0, sizeof(_RemapRadial));
+	}
+	int32_t width;				/* output image width */
+	int32_t height;				/* output image height */
+	int32_t srcW;				/* source image width */
+	int32_t srcH;				/* source image height */
+	float32_t cIn[2];			/* output optic center */
+	float32_t mIn[4];			/* output pixel to normalized plane, row major 2x2 */
+	float32_t cOut[2];			/* source optic center */
+	float32_t mOut[4];			/* normalized plane to source pixel, row major 2x2 */
+	float32_t kInvStep;			/* lut entries per unit |in|^2 */
+	int32_t lutSize;			/* number of lut entries */
+	float32_t* lut;				/* scale at |in|^2 = idx / kInvStep */
+}RemapRadial;
+
+/**
+* @brief set a virtual pinhole camera sharing the image size and optic
+*        center of the camera model
+* @param pin   [out] virtual pinhole camera
+* @param model [in]  camera model
+* @param type  [in]  camera model type, align with [CameraModel]
+* @param fov   [in]  horizontal field of view, in degree
+* @return success flag
+*/
+CFlags setVirtualPinhole(PinholeInt* pin, void* model, int32_t type, float32_t fov);
+
+/**
+* @brief build full resolution remap maps between a camera model and a
+*        virtual pinhole camera. the map is split into REMAP_TILE_W x
+*        REMAP_TILE_H tiles that run on the thread pool
+* @param map   [out] remap map, released by releaseRemap
+* @param model [in]  camera model, CamInt or CamIntKannalaBrandt
+* @param type  [in]  camera model type, align with [CameraModel]
+* @param pin   [in]  virtual pinhole camera
+* @param dir   [in]  remap direction
+* @param pool  [in]  thread pool
+* @return success flag
+*/
+CFlags buildRemap(RemapMap* map, void* model, int32_t type, PinholeInt* pin, RemapDirection dir, ThreadPool* pool);
+
+/**
+* @brief save remap maps as binary file, "REMAP_DATA", width, height,
+*        then mapU and mapV as float32
+* @param path [in] save path
+* @param map  [in] remap map
+* @return success flag
+*/
+CFlags saveRemap(const char* path, RemapMap* map);
+
+/**
+* @brief release remap maps
+* @param map [in] remap map
+* @return void return
+*/
+void releaseRemap(RemapMap* map);
+
+/**
+* @brief convert remap maps to fixed point for a source image size,
+*        source coordinates outside the image map to REMAP_NO_SOURCE
+* @param fixed  [out] fixed point map, released by releaseRemapFixed
+* @param map    [in]  remap map
+* @param srcW   [in]  source image width, in [2, 32767]
+* @param srcH   [in]  source image height, in [2, 32767]
+* @param format [in]  image format, IMAGE_NV12 also builds the chroma map
+* @return success flag
+*/
+CFlags convertRemapFixed(RemapFixed* fixed, RemapMap* map, int32_t srcW, int32_t srcH, ImageFormat format);
+
+/**
+* @brief apply a fixed point remap map to an image, bilinear, pixels
+*        without a source are set to 0. the output is walked in
+*        REMAP_TILE_W x REMAP_TILE_H tiles so the source footprint of a
+*        tile stays in cache, SIMD lanes gather their 2x2 footprints
+* @param dst   [out] output image, size of the map, same format as src
+* @param src   [in]  source image, size the map was converted for
+* @param fixed [in]  fixed point remap map
+* @param pool  [in]  thread pool to run tiles on, NULL runs on the calling thread
+* @return success flag
+*/
+CFlags remapImage(ImageU8* dst, const ImageU8* src, RemapFixed* fixed, ThreadPool* pool);
+
+/**
+* @brief release fixed point remap map
+* @param fixed [in] fixed point remap map
+* @return void return
+*/
+void releaseRemapFixed(RemapFixed* fixed);
+
+/**
+* @brief build a radial remap between a camera model and a virtual pinhole
+*        camera, a few kilobytes instead of full maps. the lut grows until
+*        linear interpolation is within REMAP_RADIAL_TOL pixel
+* @param radial [out] radial remap, released by releaseRemapRadial
+* @param model  [in]  camera model, CamInt or CamIntKannalaBrandt
+* @param type   [in]  camera model type, align with [CameraModel]
+* @param pin    [in]  virtual pinhole camera
+* @param dir    [in]  remap direction
+* @return success flag
+*/
+CFlags buildRemapRadial(RemapRadial* radial, void* model, int32_t type, PinholeInt* pin, RemapDirection dir);
+
+/**
+* @brief expand a radial remap to full remap maps, same layout as buildRemap
+* @param map    [out] remap map, released by releaseRemap
+* @param radial [in]  radial remap
+* @return success flag
+*/
+CFlags expandRemapRadial(RemapMap* map, RemapRadial* radial);
+
+/**
+* @brief save radial remap as binary file, "REMAP_RLUT", width, height,
+*        srcW, srcH, cIn, mIn, cOut, mOut, kInvStep, lutSize then the lut
+* @param path   [in] save path
+* @param radial [in] radial remap
+* @return success flag
+*/
+CFlags saveRemapRadial(const char* path, RemapRadial* radial);
+
+/**
+* @brief apply a radial remap to an image, like remapImage but the source
+*        coordinates of each tile row are made on the fly from the lut
+* @param dst    [out] output image, size of the remap, same format as src
+* @param src    [in]  source image, size of the remap source
+* @param radial [in]  radial remap
+* @param pool   [in]  thread pool to run tiles on, NULL runs on the calling thread
+* @return success flag
+*/
+CFlags remapImageRadial(ImageU8* dst, const ImageU8* src, RemapRadial* radial, ThreadPool* pool);
+
+/**
+* @brief release radial remap
+* @param radial [in] radial remap
+* @return void return
+*/
+void releaseRemapRadial(RemapRadial* radial);
+#endif
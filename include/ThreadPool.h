@@ -0,0 +1,63 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: fixed size thread pool for data parallel stages
+*/
+#ifndef __DEFINE_THREAD_POOL__
+#define __DEFINE_THREAD_POOL__
+#include "common.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class ThreadPool
+{
+public:
+	/**
+	* Constructor, start worker threads
+	* @param nThreads [in] number of threads, including the calling thread,
+	*                      0 means one per hardware thread
+	*/
+	explicit ThreadPool(int32_t nThreads = 0);
+
+	/**
+	* DeConstructor, stop and join worker threads
+	*/
+	~ThreadPool();
+
+	/**
+	* Number of threads running tasks, including the calling thread
+	* @return number of threads
+	*/
+	int32_t size() const { return int32_t(workers.size()) + 1; }
+
+	/**
+	* Run task(0) ... task(nTasks - 1) on all threads and wait for them,
+	* tasks are handed out one by one so uneven tasks balance out
+	* @param nTasks [in] number of tasks
+	* @param task   [in] task body, called with the task index
+	* @return void return
+	*/
+	void parallelFor(int32_t nTasks, const std::function<void(int32_t)>& task);
+
+private:
+	void workerLoop();
+	void runTasks();
+
+	std::vector<std::thread>				workers;
+	std::mutex								callMutex;	/* one parallelFor at a time */
+	std::mutex								mutex;
+	std::condition_variable					cvStart;
+	std::condition_variable					cvDone;
+	const std::function<void(int32_t)>*		job;
+	std::atomic<int32_t>					nextTask;
+	int32_t									nTasks;
+	int32_t									nBusy;
+	uint32_t								generation;
+	bool									stop;
+};
+#endif
@@ -4,6 +4,7 @@
 #include <math.h>
 #include <vector>
 #include <memory.h>
+#include "CurveBuffer.h"
 
 #define PI				(3.14159265358979323846264)
 #define DEG2RAD			(PI/180.0F)
@@ -24,6 +25,10 @@
 
 #define DEFAULT_CURVE_SIZE (1001)
 #define DEFAULT_CURVE_STEP (0.1)
+#define DEFAULT_RLUT_SCALE (4)		/* inverse curve size, times of disortion curve size */
+#define DEFAULT_GUIDE_SCALE (2)		/* angle guide size, times of disortion curve size */
+#define DEFAULT_SPLINE_SIZE (64)	/* first number of spline knots tried */
+#define DEFAULT_SPLINE_TOLERANCE (2e-6)	/* max radius error of the spline at the curve points, in mm, text curves hold 6 decimals */
 
 enum CameraModel
 {
@@ -46,8 +51,14 @@ typedef unsigned int       uint32_t;
 typedef float              float32_t;
 typedef double             float64_t;
 
+/* copies own their curves, a copy duplicates dRadius, dAngle, aGuide, sCoef and rLut */
 typedef struct _CamInt
 {
+	_CamInt()
+		: imgH(0), imgW(0), cu(0), cv(0), fu(0), fv(0), c(0), d(0), e(0),
+		  dStep(0), dCurveSize(0), aStep(0), sCurveSize(0), sStep(0), rStep(0), rLutSize(0)
+	{
+	}
 	int32_t imgH;					/* Image height, in pixel */
 	int32_t imgW;					/* Image width, in pixel */
 	float32_t cu;					/* Optic center, u, in pixel */
@@ -57,11 +68,42 @@ typedef struct _CamInt
 	float32_t c;					/* Skew c */
 	float32_t d;					/* Skew d */
 	float32_t e;					/* Skew e */
-	float32_t dStep;				/* Disortion curve type */
+	float32_t dStep;				/* Disortion curve angle step, in degree */
 	int32_t dCurveSize;				/* Disortion curve size */
-	float32_t *dCurve;				/* Disortion curve points */
+	CurveBuffer dRadius;			/* Disortion curve radius, in mm, of point idx at angle idx*dStep */
+	CurveBuffer dAngle;				/* Disortion curve angle, in degree, only for a non-uniform curve,
+									   empty when point idx is at idx*dStep */
+	float32_t aStep;				/* Angle guide bin width, in degree */
+	std::vector<int32_t> aGuide;	/* Angle guide, segment holding angle idx*aStep, only for a non-uniform curve */
+	int32_t sCurveSize;				/* Spline knot count, 0 when the curve is interpolated linearly */
+	float32_t sStep;				/* Spline knot step, in rad */
+	CurveBuffer sCoef;				/* Spline coef, 4 per segment, r = c0 + u*(c1 + u*(c2 + u*c3)) at angle (idx + u)*sStep,
+									   derived from dRadius, which is kept */
+	float32_t rStep;				/* Inverse curve radius step, in mm */
+	int32_t rLutSize;				/* Inverse curve size */
+	CurveBuffer rLut;				/* Inverse curve, angle (rad) at radius idx*rStep */
 }CamInt;
 
+/**
+* @brief angle of a disortion curve point
+* @param cam [in] camera model
+* @param idx [in] curve point
+* @return angle, in degree
+*/
+inline float32_t curveAngle(const CamInt* cam, int32_t idx)
+{
+	return cam->dAngle.empty() ? idx*cam->dStep : cam->dAngle[idx];
+}
+
+/**
+* @brief drop the angles of a disortion curve when they are the uniform
+*        grid idx*dStep, so the curve is kept as radius only. call after
+*        dAngle and dRadius are loaded
+* @param cam [in/out] camera model
+* @return void return
+*/
+void dropUniformAngles(CamInt* cam);
+
 /**
 * @brief find R(radius) from A (angle) in LUT
 * @param theta [in]  target theta
@@ -70,6 +112,15 @@ typedef struct _CamInt
 */
 float32_t findRfromA(float32_t theta, CamInt* cam);
 
+/**
+* @brief find dR/dA, the slope of the disortion curve, for jacobians,
+*        analytic on the spline, the segment slope otherwise
+* @param theta [in]  target theta, in rad
+* @param cam   [cam] camera model
+* @return slope, in mm per rad, 0 outside of the curve
+*/
+float32_t findDRfromA(float32_t theta, CamInt* cam);
+
 /**
 * @brief find A (angle) from R(radius) in LUT
 * @param radius [in]  target radius
@@ -77,4 +128,105 @@ float32_t findRfromA(float32_t theta, CamInt* cam);
 * @return found radius
 */
 float32_t findAfromR(float32_t radius, CamInt* cam);
+
+/**
+* @brief find A (angle) from R(radius) for a batch of radius,
+*        uses the inverse curve, SIMD gather + lerp
+* @param radius [in]  target radius
+* @param theta  [out] found angle
+* @param n      [in]  number of radius
+* @param cam    [cam] camera model
+* @return void return
+*/
+void findAfromRBatch(const float32_t* radius, float32_t* theta, int32_t n, CamInt* cam);
+
+/**
+* @brief pixels per mm of the universal model, the FOV angle at the
+*        optic center reaches the image border, same as fitKannalaBrandt
+* @param cam [in]  camera model
+* @param mu  [out] pixels per mm, u
+* @param mv  [out] pixels per mm, v
+* @return void return
+*/
+void universalPixelScale(CamInt* cam, float32_t* mu, float32_t* mv);
+
+/**
+* @brief project 3D points to pixels with universal model, in batch
+*        theta = atan2(sqrt(x^2 + y^2), z), r = findRfromA(theta)
+*        xs = mu * r * x / sqrt(x^2 + y^2), ys likewise with mv
+*        u = cu + c * xs + d * ys, v = cv + e * xs + ys
+* @param cam [in]  camera model
+* @param x   [in]  point x
+* @param y   [in]  point y
+* @param z   [in]  point z, optic axis
+* @param u   [out] pixel u
+* @param v   [out] pixel v
+* @param n   [in]  number of points
+* @return success flag
+*/
+CFlags projectUniversal(CamInt* cam, const float32_t* x, const float32_t* y, const float32_t* z,
+	float32_t* u, float32_t* v, int32_t n);
+
+/**
+* @brief unproject pixels to unit bearing vectors with universal model, in batch
+*        builds the inverse curve if it is not built yet
+* @param cam [in]  camera model
+* @param u   [in]  pixel u
+* @param v   [in]  pixel v
+* @param x   [out] bearing x
+* @param y   [out] bearing y
+* @param z   [out] bearing z, optic axis
+* @param n   [in]  number of pixels
+* @return success flag
+*/
+CFlags unprojectUniversal(CamInt* cam, const float32_t* u, const float32_t* v,
+	float32_t* x, float32_t* y, float32_t* z, int32_t n);
+
+/**
+* @brief build inverse curve, angle at uniform radius steps, so that
+*        findAfromR is a constant time lookup, the angle guide of a
+*        non-uniform curve and the curve spline. call once per camera
+*        model, after the disortion curve is loaded
+* @param cam [in/out] camera model
+* @return success flag
+*/
+CFlags buildRadiusLut(CamInt* cam);
+
+/**
+* @brief build a monotone cubic hermite spline of the disortion curve, on
+*        uniform knots so that findRfromA is a constant time polynomial.
+*        knot radius and slope come from a local cubic through 4 curve
+*        points around the knot, slopes are limited so that the spline is
+*        monotone wherever the knots are. knots are added until the spline
+*        is as close to every curve point as the linear curve is between
+*        them, or within DEFAULT_SPLINE_TOLERANCE. the curve stays
+*        linear if that takes more memory than the curve itself. the
+*        spline is built on top of the curve, dRadius is kept as the one
+*        that is saved, fitted and resampled, findRfromA only reads sCoef
+* @param cam [in/out] camera model
+* @return success flag, CFALSE if the curve stays linear
+*/
+CFlags buildCurveSpline(CamInt* cam);
+
+/**
+* @brief build angle guide of a non-uniform curve, the segment holding
+*        each of a few uniform angle bins, so that findRfromA starts its
+*        knot search next to the target. cleared for a uniform curve
+* @param cam [in/out] camera model
+* @return void return
+*/
+void buildAngleGuide(CamInt* cam);
+
+/**
+* @brief resample the disortion curve to fewer knots, picked from its
+*        points so that the new curve is within tolerance of the old one
+*        everywhere. each knot is the farthest point whose chord from the
+*        last knot passes all points between them, so nearly linear parts
+*        get long segments and bends keep their points. builds the
+*        inverse curve and the angle guide of the new curve
+* @param cam       [in/out] camera model
+* @param tolerance [in]     max radius error, in mm
+* @return success flag
+*/
+CFlags resampleCurve(CamInt* cam, float32_t tolerance);
 #endif
\ No newline at end of file
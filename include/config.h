@@ -6,6 +6,13 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <charconv>
+#include <stdexcept>
+#include <type_traits>
+#include "MappedFile.h"
 using namespace std;
 
 /***********************************************************
@@ -27,15 +34,41 @@ enum CONFIG_RET_CHECK {
 * Struct
 ***********************************************************/
 template <typename Object>
+struct CONFIG_ELEM_ROW
+{
+	const Object* data;
+	size_t        n;
+
+	size_t size() const { return n; }
+	bool empty() const { return 0 == n; }
+	const Object& operator[](size_t idx) const { return data[idx]; }
+};
+
+/* values of a config term, one row per line, all rows in one array */
+template <typename Object>
 struct CONFIG_ELEM_DATA
 {
-	vector<vector<Object>> data;
+	vector<Object> data;	// values, row after row
+	vector<size_t> rowEnd;	// end of each row in data
+
+	size_t size() const { return rowEnd.size(); }
+	bool empty() const { return rowEnd.empty(); }
+	CONFIG_ELEM_ROW<Object> operator[](size_t row) const
+	{
+		size_t begin = (0 == row) ? 0 : rowEnd[row - 1];
+		CONFIG_ELEM_ROW<Object> ret = { data.data() + begin, rowEnd[row] - begin };
+		return ret;
+	}
+	void clear() { data.clear(); rowEnd.clear(); }
 };
 
+/* config values point into the mapped config file, no copy per value */
+typedef CONFIG_ELEM_DATA<string_view> configData;
+
 typedef struct _CONFIG_ELEM
 {
     string configName;					// config name
-	CONFIG_ELEM_DATA<string> configValue; // value in string
+	configData configValue;				// value in string
 } configElem;
 
 typedef struct _CONFIG_GROUP_ELEM
@@ -44,70 +77,73 @@ typedef struct _CONFIG_GROUP_ELEM
     CONFIG_LOAD        necessary;
     string             name;
     vector<configElem> vConfigList;
+    unordered_map<string, int> index;  // config name -> position in vConfigList, first one wins
+    shared_ptr<MappedFile> file;       // config file, configValue points into it
 } configGroupElem;
 
 typedef struct _CONFIG_GROUP
 {
     int                     iCntGroup;
     vector<configGroupElem> vConfigGroup;
+    unordered_map<string, int> index;  // group name -> position in vConfigGroup, first one wins
 } configGroup;
 
 namespace temp{
-	template <typename Object> 
-	CONFIG_RET_CHECK formConfig(Object* cfgValue, vector<vector<string>> cfgString)
+	/* parse a whole config value as a number, errc::invalid_argument if it is not one,
+	   errc::result_out_of_range if it does not fit in Object */
+	template <typename Object>
+	inline errc cfgParseNumber(string_view s, Object* value)
 	{
-		CONFIG_RET_CHECK ret = CONFIG_RET_SUCCESS;
-		/* cfgString contains config values in a matrix */
-		/* when it only contains one value, we wish the output to contain one value only */
-		if (1 == cfgString.size())
+		const char* p = s.data();
+		const char* end = p + s.size();
+		if ((p < end) && ('+' == *p) && (p + 1 < end) && ('-' != p[1]))
 		{
-			if (1 == cfgString[0].size())
-			{
-				if((typeid(Object) == typeid(int))||(typeid(Object) == typeid(unsigned int)))
-				{
-					*cfgValue = stoi(cfgString[0][0],nullptr);	
-				}
-				if((typeid(Object) == typeid(float))||(typeid(Object) == typeid(double)))
-				{
-					*cfgValue = stof(cfgString[0][0],nullptr);	
-				}
-			}
-			else
-			{
-				for (int colIdx = 0; colIdx < cfgString[0].size();colIdx++)
-				{
-					if((typeid(Object) == typeid(int))||(typeid(Object) == typeid(unsigned int)))
-					{
-						*(cfgValue + colIdx) = stoi(cfgString[0][colIdx]);	
-					}
-					if((typeid(Object) == typeid(float))||(typeid(Object) == typeid(double)))
-					{
-						*(cfgValue + colIdx) = stof(cfgString[0][colIdx]);	
-					}
-				}
-			}
+			p++;
 		}
-		else
+		from_chars_result ret = from_chars(p, end, *value);
+		if ((errc() == ret.ec) && (end != ret.ptr))
 		{
-			for (int rowIdx = 0; rowIdx < cfgString.size(); rowIdx++)
+			return errc::invalid_argument;
+		}
+		return ret.ec;
+	}
+
+	/* parse a whole config value as a number, false if it is not one */
+	template <typename Object>
+	inline bool cfgToNumber(string_view s, Object* value)
+	{
+		return errc() == cfgParseNumber(s, value);
+	}
+
+	/* config values can be converted to integers and floating points, from_chars picks
+	   the conversion for Object at compile time */
+	template <typename Object>
+	struct cfgIsNumber : integral_constant<bool, is_arithmetic<Object>::value && !is_same<Object, bool>::value> {};
+
+	template <typename Object> 
+	CONFIG_RET_CHECK formConfig(Object* cfgValue, const configData& cfgString)
+	{
+		static_assert(cfgIsNumber<Object>::value, "config value can only be converted to a number or a string");
+		CONFIG_RET_CHECK ret = CONFIG_RET_SUCCESS;
+		/* cfgString contains config values in a matrix, stored row after row */
+		/* a single value fills cfgValue only, a matrix fills cfgValue row by row */
+		const string_view* value = cfgString.data.data();
+		size_t cnt = cfgString.data.size();
+		for (size_t idx = 0; idx < cnt; idx++)
+		{
+			errc ec = cfgParseNumber(value[idx], cfgValue + idx);
+			if (errc() != ec)
 			{
-				for (int colIdx = 0; colIdx < cfgString[0].size(); colIdx++)
-				{
-					if((typeid(Object) == typeid(int))||(typeid(Object) == typeid(unsigned int)))
-					{
-						*(cfgValue + rowIdx*cfgString[rowIdx].size() + colIdx) = stoi(cfgString[rowIdx][colIdx]);	
-					}
-					if((typeid(Object) == typeid(float))||(typeid(Object) == typeid(double)))
-					{
-						*(cfgValue + rowIdx*cfgString[rowIdx].size() + colIdx) = stof(cfgString[rowIdx][colIdx]);	
-					}
-				}
+				ret = CONFIG_RET_FAIL;
+				printf("Error! config value [%.*s] %s\n", int(value[idx].size()), value[idx].data(),
+					(errc::result_out_of_range == ec) ? "is out of range" : "is not a number");
+				break;
 			}
 		}
 		return ret;
 	}
 	template <> inline
-	CONFIG_RET_CHECK formConfig(string* cfgValue, vector<vector<string>> cfgString)
+	CONFIG_RET_CHECK formConfig(string* cfgValue, const configData& cfgString)
 	{
 		CONFIG_RET_CHECK ret = CONFIG_RET_SUCCESS;
 		/* cfgString contains config values in a matrix */
@@ -116,7 +152,7 @@ namespace temp{
 		{
 			if (1 == cfgString[0].size())
 			{
-				*cfgValue = cfgString[0][0];
+				*cfgValue = string(cfgString[0][0]);
 			}
 			else
 			{
@@ -166,7 +202,8 @@ public:
     */
 	CONFIG_RET_CHECK getConfigGroup(configGroupElem& cfgGroup, int idx);
     /**
-    * Load config file and printf necessary messages
+    * Load config file and printf necessary messages, the file is mapped and
+    * split into words in place, config values point into the mapping
     * @param  configPath      [in] full path to the config file
     * @return standard return check
     */
@@ -180,6 +217,24 @@ public:
     */
 	CONFIG_RET_CHECK findConfigGroup(vector<configElem>& vConfigList, const char* groupName);
 
+    /**
+    * Find config group in config bank without copying it
+    * @param cfgGroup  [out] found config group, NULL if it is omitted
+    * @param groupName [in]  target group name
+    * @return standard return check
+    */
+	CONFIG_RET_CHECK findConfigGroup(const configGroupElem*& cfgGroup, const char* groupName);
+
+	/**
+	* Look up config value in config bank without copying it, the values
+	* point into the mapped config file and stay valid as long as the bank
+	* @param cfgValue  [out] config values in string, empty if the term is omitted
+	* @param cfgName   [in]  target cfg name
+	* @param cfgGroup  [in]  config group name
+	* @return standard return check
+	*/
+	CONFIG_RET_CHECK findCfgString(const configData*& cfgValue, const char *cfgName, const char *cfgGroup);
+
 	/**
 	* Check whether one config term's value equals to someting
 	* @param cfgName  	[in] config term name
@@ -209,11 +264,15 @@ public:
 	CONFIG_RET_CHECK extractCfgValue(Object* cfgValue, const char *cfgName, const char *cfgGroup)
 	{
 		CONFIG_RET_CHECK ret = CONFIG_RET_FAIL;
-		vector<vector<string>> cfgString;
-		ret = extCfgString(cfgString,cfgName,cfgGroup);
+		const configData* cfgString = NULL;
+		ret = findCfgString(cfgString,cfgName,cfgGroup);
 		if (CONFIG_RET_SUCCESS == ret)
 		{
-			ret = temp::formConfig(cfgValue,cfgString);
+			ret = temp::formConfig(cfgValue,*cfgString);
+			if (CONFIG_RET_SUCCESS != ret)
+			{
+				printf("Could not convert config term [%s], failed -- \n", cfgName);
+			}
 		}
 		// else
 		// {
@@ -222,6 +281,13 @@ public:
 		return ret;
 	}
 private:
+    /**
+    * Index config names of a loaded group and append it to config bank
+    * @param cfgGroup [in] loaded config group, moved into config bank
+    * @return void return
+    */
+    void addConfigGroup(configGroupElem& cfgGroup);
+
     vector<string>  vLineCommentSymbol;
     configGroup     vConfigBank;
     string          sGroupName;
@@ -5,11 +5,16 @@
 #ifndef __MATH_MATRIX_H__
 #define __MATH_MATRIX_H__
 
+#include "MappedFile.h"
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <new>
 #include <sstream>
 #include <vector>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 using std::vector;
 using std::string;
@@ -18,22 +23,41 @@ using std::cin;
 using std::istream;
 using std::ostream;
 
+#define MATRIX_ALIGN	64			// ׵ַֽ, һ
+
 // ;
+// ݰ洢һ MATRIX_ALIGN ڴ, пȲ뵽 MATRIX_ALIGN
 template <typename Object>
 class MATRIX
 {
 public:
-	explicit MATRIX() : array( 0 ) {}
+	explicit MATRIX() : data( NULL ), nRows( 0 ), nCols( 0 ), nStride( 0 ), nRowCap( 0 ) {}
 
-	MATRIX( int rows, int cols):array( rows )
+	MATRIX( int rows, int cols ) : data( NULL ), nRows( 0 ), nCols( 0 ), nStride( 0 ), nRowCap( 0 )
 	{
-		for( int i = 0; i < rows; ++i )
-		{
-			array[i].resize( cols );
-		}
+		resize( rows, cols );
 	}
 
-	MATRIX( const MATRIX<Object>& m ){ *this = m;}
+	MATRIX( const MATRIX<Object>& m ) : data( NULL ), nRows( 0 ), nCols( 0 ), nStride( 0 ), nRowCap( 0 )
+	{
+		*this = m;
+	}
+
+	// ƶ, ӹmڴ, mΪվ
+	MATRIX( MATRIX<Object>&& m ) noexcept
+		: data( m.data ), nRows( m.nRows ), nCols( m.nCols ), nStride( m.nStride ), nRowCap( m.nRowCap )
+	{
+		m.data = NULL;
+		m.nRows = 0;
+		m.nCols = 0;
+		m.nStride = 0;
+		m.nRowCap = 0;
+	}
+
+	~MATRIX() { release( data ); }
+
+	MATRIX<Object>& operator=( const MATRIX<Object>& m );
+	MATRIX<Object>& operator=( MATRIX<Object>&& m ) noexcept;
 
 	void resize( int rows, int cols );           // ı䵱ǰС
 	bool push_back( const vector<Object>& v );   // ھĩβһ
@@ -42,22 +66,134 @@ public:
 
     void zeros(int rows, int cols);				// Ϊȫ
 
-    int  rows() const{ return (int)array.size(); }
-	int  cols() const { return rows() ? ((int)array[0].size()) : 0; }
+    int  rows() const{ return nRows; }
+	int  cols() const { return nCols; }
+	int  stride() const { return nStride; }           // п, Ԫظ
 	bool empty() const { return rows() == 0; }        // ǷΪ
 	bool square() const { return (!(empty()) && rows() == cols()); }  // ǷΪ
 	
-	const vector<Object>& operator[](int row) const { return array[row]; } //[] 
-	vector<Object>& operator[](int row){ return array[row]; }
+	const Object* operator[](int row) const { return data + (size_t)row * nStride; } //[], ׵ַ
+	Object* operator[](int row){ return data + (size_t)row * nStride; }
 
 	int* toi(void);                             // matrix to int
 	float* tof(void);                             // matrix to float
 	double* tolf( void );                           // matrix to double
 	
 protected:
-	vector< vector<Object> > array;
+	static int strideOf( int cols );             // Ӧп
+	static Object* allocate( int rows, int stride ); // ڴ沢
+	static void release( Object* p );            // ͷŶڴ
+	void reserve( int rows, int cols );          // ·ڴ, صֵ
+
+	Object* data;           // 
+	int nRows;              // 
+	int nCols;              // 
+	int nStride;            // п, Ԫظ
+	int nRowCap;            // ѷ
 };
 
+template <typename Object>
+int MATRIX<Object>::strideOf( int cols )
+{
+	static_assert( std::is_trivially_copyable<Object>::value, "MATRIX element must be trivially copyable" );
+	static_assert( MATRIX_ALIGN % sizeof(Object) == 0, "MATRIX element must divide MATRIX_ALIGN" );
+	const int lanes = MATRIX_ALIGN / (int)sizeof(Object);
+	return (cols + lanes - 1) / lanes * lanes;
+}
+
+template <typename Object>
+Object* MATRIX<Object>::allocate( int rows, int stride )
+{
+	size_t n = (size_t)rows * stride;
+	if ( n == 0 )
+	{
+		return NULL;
+	}
+	Object* p = static_cast<Object*>( ::operator new( n * sizeof(Object), std::align_val_t( MATRIX_ALIGN ) ) );
+	memset( p, 0, n * sizeof(Object) );
+	return p;
+}
+
+template <typename Object>
+void MATRIX<Object>::release( Object* p )
+{
+	if ( p != NULL )
+	{
+		::operator delete( p, std::align_val_t( MATRIX_ALIGN ) );
+	}
+}
+
+// · rowCap еڴ, صֵ, 
+template <typename Object>
+void MATRIX<Object>::reserve( int rowCap, int cols )
+{
+	int stride = strideOf( cols );
+	Object* p = allocate( rowCap, stride );
+	int r = nRows < rowCap ? nRows : rowCap;
+	int c = nCols < cols ? nCols : cols;
+
+	for ( int i = 0; i < r && c > 0; ++i )
+	{
+		memcpy( p + (size_t)i * stride, (*this)[i], c * sizeof(Object) );
+	}
+
+	release( data );
+	data = p;
+	nCols = cols;
+	nStride = stride;
+	nRowCap = rowCap;
+	if ( nRows > rowCap ) nRows = rowCap;
+}
+
+// ƾ, ڴ㹻ʱ·
+template <typename Object>
+MATRIX<Object>& MATRIX<Object>::operator=( const MATRIX<Object>& m )
+{
+	if ( this == &m )
+	{
+		return *this;
+	}
+
+	if ( nCols != m.nCols || nRowCap < m.nRows )
+	{
+		release( data );
+		data = NULL;
+		nRows = 0;
+		nRowCap = 0;
+		reserve( m.nRows, m.nCols );
+	}
+
+	nRows = m.nRows;
+	if ( nRows > 0 && nStride > 0 )
+	{
+		memcpy( data, m.data, (size_t)nRows * nStride * sizeof(Object) );
+	}
+	return *this;
+}
+
+// ƶֵ, ͷŵǰڴ沢ӹmڴ, mΪվ
+template <typename Object>
+MATRIX<Object>& MATRIX<Object>::operator=( MATRIX<Object>&& m ) noexcept
+{
+	if ( this == &m )
+	{
+		return *this;
+	}
+
+	release( data );
+	data = m.data;
+	nRows = m.nRows;
+	nCols = m.nCols;
+	nStride = m.nStride;
+	nRowCap = m.nRowCap;
+	m.data = NULL;
+	m.nRows = 0;
+	m.nCols = 0;
+	m.nStride = 0;
+	m.nRowCap = 0;
+	return *this;
+}
+
 // ı䵱ǰС
 template <typename Object>
 void MATRIX<Object>::resize( int rows, int cols )
@@ -69,28 +205,19 @@ void MATRIX<Object>::resize( int rows, int cols )
 	{
 		return;
 	}
-	else if ( rows == rs && cols != cs )
+	else if ( cols == cs && rows <= nRowCap )
 	{
-		for ( int i = 0; i < rows; ++i )
+		// 
+		if ( rows > rs )
 		{
-			array[i].resize( cols );
-		}
-	}
-	else if ( rows != rs && cols == cs )
-	{
-		array.resize( rows );
-		for ( int i = rs; i < rows; ++i )
-		{
-			array[i].resize( cols );
+			memset( (*this)[rs], 0, (size_t)(rows - rs) * nStride * sizeof(Object) );
 		}
+		nRows = rows;
 	}
 	else
 	{
-		array.resize( rows );
-		for ( int i = 0; i < rows; ++i )
-		{
-			array[i].resize( cols );
-		}
+		reserve( rows, cols );
+		nRows = rows;
 	}
 }
 
@@ -98,15 +225,9 @@ void MATRIX<Object>::resize( int rows, int cols )
 template <typename Object>
 void MATRIX<Object>::clear()
 {
-	int rs = this->rows();
-	int cs = this->cols();
-
-	for (int i = 0; i < rs; ++i)
+	if ( nRows > 0 && nStride > 0 )
 	{
-		for (int j = 0; j < cs; ++j)
-		{
-			array[i][j] = 0;
-		}
+		memset( data, 0, (size_t)nRows * nStride * sizeof(Object) );
 	}
 }
 
@@ -118,40 +239,58 @@ void MATRIX<Object>::zeros(int rows, int cols)
     this->clear();
 }
 
-// ھĩβһ
+// ھĩβһ, ڴ水
 template <typename Object>
 bool MATRIX<Object>::push_back( const vector<Object>& v )
 {
-	if ( rows() == 0 || cols() == (int)v.size() )
+	int c = (int)v.size();
+
+	if ( rows() == 0 )
 	{
-		array.push_back( v );
+		if ( c != nCols || nRowCap == 0 )
+		{
+			reserve( nRowCap > 4 ? nRowCap : 4, c );
+		}
 	}
-	else
+	else if ( cols() != c )
 	{
 		return false;
 	}
+	else if ( nRows == nRowCap )
+	{
+		reserve( 2 * nRowCap, c );
+	}
+
+	if ( c > 0 )
+	{
+		memcpy( (*this)[nRows], &v[0], c * sizeof(Object) );
+	}
+	nRows++;
 
 	return true;
 }
 
-// 
+// , ԭԪؽ
 template <typename Object>
 void MATRIX<Object>::swap_row( int row1, int row2 )
 {
 	if ( row1 != row2 && row1 >=0 &&
 		row1 < rows() && row2 >= 0 && row2 < rows() )
 	{
-		vector<Object>& v1 = array[row1];
-		vector<Object>& v2 = array[row2];
-		vector<Object> tmp = v1;
-		v1 = v2;
-		v2 = tmp;
+		Object* v1 = (*this)[row1];
+		Object* v2 = (*this)[row2];
+		for ( int j = 0; j < nCols; ++j )
+		{
+			Object tmp = v1[j];
+			v1[j] = v2[j];
+			v2[j] = tmp;
+		}
 	}
 }
 
 // ת
 template <typename Object>
-const MATRIX<Object> trans( const MATRIX<Object>& m )
+MATRIX<Object> trans( const MATRIX<Object>& m )
 {
 	MATRIX<Object> ret;
 	if ( m.empty() ) return ret;
@@ -185,7 +324,7 @@ int* MATRIX<Object>::toi(void)
 	{
 		for (int j = 0; j < c; ++j)
 		{
-			result[i*c + j] = (int)array[i][j];
+			result[i*c + j] = (int)(*this)[i][j];
 		}
 	}
 	return result;
@@ -205,7 +344,7 @@ float* MATRIX<Object>::tof(void)
 	{
 		for (int j = 0; j < c; ++j)
 		{
-			result[i*c + j] = (float)array[i][j];
+			result[i*c + j] = (float)(*this)[i][j];
 		}
 	}
 	return result;
@@ -225,62 +364,318 @@ double* MATRIX<Object>::tolf(void)
 	{
 		for (int j = 0; j < c; ++j)
 		{
-			result[i*c + j] = array[i][j];
+			result[i*c + j] = (*this)[i][j];
 		}
 	}
 	return result;
 }
 
+//////////////////////////////////////////////////////////
+// Ԫıʽģ
+// ӼļӼ˳ֻɱʽ, ֵMatrixʱԪһ,
+//  a*s + b - c м
+// ʽñеMatrix, Ҫautoʽֵ֮
+class Matrix;
+
+template <typename E>
+struct MatExpr
+{
+	const E& self() const { return static_cast<const E&>( *this ); }
+};
+
+// ʽڵ㰴ֵ, Matrixñ
+template <typename E>
+struct MatExprRef { typedef const E type; };
+
+template <>
+struct MatExprRef<Matrix> { typedef const Matrix& type; };
+
+struct MatAdd { static double apply( double a, double b ) { return a + b; } };
+struct MatSub { static double apply( double a, double b ) { return a - b; } };
+struct MatMul { static double apply( double a, double b ) { return a * b; } };
+struct MatDiv { static double apply( double a, double b ) { return a / b; } };
+
 //////////////////////////////////////////////////////////
 // double;࣬ڿѧ
 // ̳MATRIX
 // ʵֳòأʵּʽԼLUֽ
-class Matrix:public MATRIX<double>
+class Matrix:public MATRIX<double>, public MatExpr<Matrix>
 {
 public:
 	Matrix():MATRIX<double>(){}
 	Matrix( int c, int r ):MATRIX<double>(c,r){}
-	Matrix( const Matrix& m){ *this  = m; }
-
-	const Matrix& operator =( int* a );
-	const Matrix& operator =( float* a );
-	const Matrix& operator =( double* a );
-	const Matrix& operator =( const Matrix& m );
-	const Matrix& operator+=( const Matrix& m );
-	const Matrix& operator-=( const Matrix& m );
-	const Matrix& operator*=( const Matrix& m );
-	const Matrix& operator/=( const Matrix& m );
+	Matrix( const Matrix& m ):MATRIX<double>(m){}
+	Matrix( Matrix&& m ) noexcept :MATRIX<double>(std::move(m)){}
+
+	template <typename E>
+	Matrix( const MatExpr<E>& e ):MATRIX<double>(e.self().rows(), e.self().cols()){ eval( e.self() ); }  // ʽֵ
+
+	Matrix& operator =( int* a );
+	Matrix& operator =( float* a );
+	Matrix& operator =( double* a );
+	Matrix& operator =( const Matrix& m );
+	Matrix& operator =( Matrix&& m );
+	Matrix& operator+=( const Matrix& m );
+	Matrix& operator-=( const Matrix& m );
+	Matrix& operator*=( const Matrix& m );
+	Matrix& operator/=( const Matrix& m );
+
+	template <typename E> Matrix& operator =( const MatExpr<E>& e );
+	template <typename E> Matrix& operator+=( const MatExpr<E>& e );
+	template <typename E> Matrix& operator-=( const MatExpr<E>& e );
+
+	double at( int i, int j ) const { return (*this)[i][j]; }  // ʽҶڵȡֵ
+
+private:
+	template <typename E> void eval( const E& e );              // дʽֵ, ߴͬ
 };
 
+// ʽԪ, ߴ粻ͬʱΪվ
+template <typename L, typename R, typename Op>
+class MatBinary : public MatExpr< MatBinary<L, R, Op> >
+{
+public:
+	MatBinary( const L& l, const R& r ) : lhs( l ), rhs( r ) {}
+
+	int rows() const { return same() ? lhs.rows() : 0; }
+	int cols() const { return same() ? lhs.cols() : 0; }
+	double at( int i, int j ) const { return Op::apply( lhs.at( i, j ), rhs.at( i, j ) ); }
+
+private:
+	bool same() const { return lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols(); }
+
+	typename MatExprRef<L>::type lhs;
+	typename MatExprRef<R>::type rhs;
+};
+
+// ʽԪ
+template <typename L, typename Op>
+class MatScalar : public MatExpr< MatScalar<L, Op> >
+{
+public:
+	MatScalar( const L& l, float s ) : lhs( l ), rhs( s ) {}
+
+	int rows() const { return lhs.rows(); }
+	int cols() const { return lhs.cols(); }
+	double at( int i, int j ) const { return Op::apply( lhs.at( i, j ), rhs ); }
+
+private:
+	typename MatExprRef<L>::type lhs;
+	float rhs;
+};
+
+template <typename E>
+void Matrix::eval( const E& e )
+{
+	int r = rows();
+	int c = cols();
+	for ( int i = 0; i < r; ++i )
+	{
+		double* dst = (*this)[i];
+		for ( int j = 0; j < c; ++j )
+		{
+			dst[j] = e.at( i, j );
+		}
+	}
+}
+
+//  operator=(const Matrix&) ͬ, ǿҳߴ粻ͬʱֵ
+// ʽֻȡͬһλõԪ, ֱдزľ
+template <typename E>
+Matrix& Matrix::operator=( const MatExpr<E>& e )
+{
+	const E& x = e.self();
+	if ( !empty() && ( rows() != x.rows() || cols() != x.cols() ) )
+	{
+		return *this;
+	}
+	if ( empty() ) resize( x.rows(), x.cols() );
+	eval( x );
+	return *this;
+}
+
+template <typename E>
+Matrix& Matrix::operator+=( const MatExpr<E>& e )
+{
+	const E& x = e.self();
+	if ( rows() != x.rows() || cols() != x.cols() )
+	{
+		return *this;
+	}
+	for ( int i = 0; i < rows(); ++i )
+	{
+		double* dst = (*this)[i];
+		for ( int j = 0; j < cols(); ++j )
+		{
+			dst[j] += x.at( i, j );
+		}
+	}
+	return *this;
+}
+
+template <typename E>
+Matrix& Matrix::operator-=( const MatExpr<E>& e )
+{
+	const E& x = e.self();
+	if ( rows() != x.rows() || cols() != x.cols() )
+	{
+		return *this;
+	}
+	for ( int i = 0; i < rows(); ++i )
+	{
+		double* dst = (*this)[i];
+		for ( int j = 0; j < cols(); ++j )
+		{
+			dst[j] -= x.at( i, j );
+		}
+	}
+	return *this;
+}
+
+template <typename L, typename R>
+MatBinary<L, R, MatAdd> operator+( const MatExpr<L>& lhs, const MatExpr<R>& rhs )   // ز+
+{
+	return MatBinary<L, R, MatAdd>( lhs.self(), rhs.self() );
+}
+
+template <typename L, typename R>
+MatBinary<L, R, MatSub> operator-( const MatExpr<L>& lhs, const MatExpr<R>& rhs )   // ز-
+{
+	return MatBinary<L, R, MatSub>( lhs.self(), rhs.self() );
+}
+
+template <typename L>
+MatScalar<L, MatAdd> operator+( const MatExpr<L>& lhs, const float rhs )  // ز+
+{
+	return MatScalar<L, MatAdd>( lhs.self(), rhs );
+}
+
+template <typename L>
+MatScalar<L, MatAdd> operator+( const float rhs, const MatExpr<L>& lhs )  // ز+
+{
+	return MatScalar<L, MatAdd>( lhs.self(), rhs );
+}
+
+template <typename L>
+MatScalar<L, MatSub> operator-( const MatExpr<L>& lhs, const float rhs )  // ز-
+{
+	return MatScalar<L, MatSub>( lhs.self(), rhs );
+}
+
+template <typename L>
+MatScalar<L, MatMul> operator*( const MatExpr<L>& lhs, const float rhs )  // ز*
+{
+	return MatScalar<L, MatMul>( lhs.self(), rhs );
+}
+
+template <typename L>
+MatScalar<L, MatMul> operator*( const float rhs, const MatExpr<L>& lhs )  // ز*
+{
+	return MatScalar<L, MatMul>( lhs.self(), rhs );
+}
+
+template <typename L>
+MatScalar<L, MatDiv> operator/( const MatExpr<L>& lhs, const float rhs )  // ز/
+{
+	return MatScalar<L, MatDiv>( lhs.self(), rhs );
+}
+
+//////////////////////////////////////////////////////////
+// ԪLUֽ, PA = LU
+// ֽһκҶ
+class LUDecomp
+{
+public:
+	LUDecomp() : sign( 1 ) {}
+	explicit LUDecomp( const Matrix& m ) : sign( 1 ) { compute( m ); }
+
+	bool compute( const Matrix& m );             // ֽⷽ, ʱfalse
+	bool ok() const { return !lu.empty(); }      // ֽǷɹ
+	Matrix solve( const Matrix& B ) const;       //  AX = B, BÿһΪһҶ
+	const double det() const;                    // ʽ
+	Matrix inverse() const;                      // 
+
+private:
+	Matrix lu;              // ǲִ洢L(ԽԪΪ1, 洢), ǲִ洢U
+	vector<int> perm;       // iAĵperm[i]
+	int sign;               // нż, 1-1
+};
+
+//////////////////////////////////////////////////////////
+// ԳCholeskyֽ, A = LL^T
+// ֽһκҶ
+class CholeskyDecomp
+{
+public:
+	CholeskyDecomp() {}
+	explicit CholeskyDecomp( const Matrix& m ) { compute( m ); }
+
+	bool compute( const Matrix& m );             // ֽⷽ, ʱfalse, ֻʹǲ
+	bool ok() const { return !L.empty(); }       // ֽǷɹ
+	Matrix solve( const Matrix& B ) const;       //  AX = B, BÿһΪһҶ
+
+private:
+	Matrix L;               // Ǿ
+};
+
+//////////////////////////////////////////////////////////
+// saveMatrixĶļֻͼ
+// ļֱӳ䵽ڴ, װ MATRIX_ALIGN , ʱҲ
+// ΪʽҶڵ,  Matrix m = v * 2.0
+class MatrixView : public MatExpr<MatrixView>
+{
+public:
+	MatrixView() : base( NULL ), nRows( 0 ), nCols( 0 ), nStride( 0 ) {}
+	explicit MatrixView( string file ) : base( NULL ), nRows( 0 ), nCols( 0 ), nStride( 0 ) { open( file ); }
+	MatrixView( MatrixView&& v ) noexcept;
+	MatrixView& operator=( MatrixView&& v ) noexcept;
+
+	bool open( string file );                    // ӳļ, ɸʽֽͬļfalse
+	void close();                                // ӳ
+
+	int rows() const { return nRows; }
+	int cols() const { return nCols; }
+	int stride() const { return nStride; }       // ÿеԪظ, 
+	bool empty() const { return nRows == 0; }
+
+	const double* operator[]( int row ) const { return base + (size_t)row * nStride; }
+	double at( int i, int j ) const { return base[(size_t)i * nStride + j]; }  // ʽҶڵȡֵ
+	Matrix toMatrix() const { return Matrix( *this ); }                        // Ϊ
+
+private:
+	MappedFile file;
+	const double* base;     // 0, λӳ
+	int nRows;
+	int nCols;
+	int nStride;
+};
+
+template <>
+struct MatExprRef<MatrixView> { typedef const MatrixView& type; };
+
 bool  operator==(const Matrix& lhs, const Matrix& rhs);        // ز==
 bool  operator!=(const Matrix& lhs, const Matrix& rhs);        // ز!=
 
-const Matrix operator+(const Matrix& lhs, const float rhs);  // ز+
-const Matrix operator+(const float rhs, const Matrix& lhs);  // ز+
-const Matrix operator-(const Matrix& lhs, const float rhs);  // ز-
-const Matrix operator*(const Matrix& lhs, const float rhs);  // ز*
-const Matrix operator*(const float rhs, const Matrix& lhs);  // ز*
-const Matrix operator/(const Matrix& lhs, const float rhs);  // ز/
-
-const Matrix operator+(const Matrix& lhs, const Matrix& rhs);  // ز+
-const Matrix operator-(const Matrix& lhs, const Matrix& rhs);  // ز-
-const Matrix operator*(const Matrix& lhs, const Matrix& rhs);  // ز*
-const Matrix operator/(const Matrix& lhs, const Matrix& rhs);  // ز/
+Matrix operator*(const Matrix& lhs, const Matrix& rhs);        // ز*
+Matrix operator/(const Matrix& lhs, const Matrix& rhs);        // ز/
 const double det(const Matrix& m);                             // ʽ
 const double det(const Matrix& m, int start, int end);         // Ӿʽ
-const Matrix abs(const Matrix& m);                             // Ԫصľֵ
+Matrix abs(const Matrix& m);                                   // Ԫصľֵ
 const double max(const Matrix& m);                             // Ԫصֵ
 const double max(const Matrix& m, int& row, int& col);          // Ԫеֵ±
 const double min(const Matrix& m);                             // ԪصСֵ
 const double min(const Matrix& m, int& row, int& col);          // ԪصСֵ±
 const double sum(const Matrix& m);                               // Ԫ֮
-const Matrix trans(const Matrix& m);                           // תþ
-const Matrix submatrix(const Matrix& m, int rb, int re, int cb, int ce);  // Ӿ
-const Matrix inverse(const Matrix& m);                         // 
-const Matrix LU(const Matrix& m);                              // 㷽LUֽ
-const Matrix readMatrix(istream& in = std::cin);               // ָ
-const Matrix readMatrix(string file);                          // ıļ
-const Matrix loadMatrix(string file);                          // Ӷļȡ
+Matrix trans(const Matrix& m);                                 // תþ
+Matrix submatrix(const Matrix& m, int rb, int re, int cb, int ce);        // Ӿ
+Matrix inverse(const Matrix& m);                               // 
+Matrix LU(const Matrix& m);                                    // 㷽LUֽ
+Matrix solve(const Matrix& A, const Matrix& B);                // LUֽ AX = B, Aʱؿվ
+Matrix solveSPD(const Matrix& A, const Matrix& B);             // CholeskyֽԳ AX = B, ֽʧʱLU
+Matrix readMatrix(istream& in = std::cin);                     // ָ
+Matrix readMatrix(string file);                                // ıļ
+Matrix loadMatrix(string file);                                // Ӷļȡ, ݾɸʽ"MATRIX_DATA"
+bool  loadMatrix(string file, MatrixView& view);               // ļӳΪֻͼ, 
 void  printMatrix(const Matrix& m, ostream& out = std::cout);  // ָӡ
 void  printMatrix(const Matrix& m, string file);                // ıļ
 void  saveMatrix(const Matrix& m, string file);                 // 󱣴Ϊļ
@@ -288,7 +683,7 @@ void  saveMatrix(const Matrix& m, string file);                 // 
 void dispMat(const Matrix& mat);
 
 
-const Matrix zeros(int row, int col);
-const Matrix eye(int dim);
+Matrix zeros(int row, int col);
+Matrix eye(int dim);
 
 #endif
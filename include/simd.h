@@ -0,0 +1,326 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: thin SIMD layer for batch kernels
+*              AVX2/FMA (8 lanes), SSE2 (4 lanes) or scalar (1 lane)
+*              is picked at compile time, kernels are written once
+*              against the vXxx functions below
+*/
+#ifndef __DEFINE_SIMD__
+#define __DEFINE_SIMD__
+#include "common.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define SIMD_WIDTH (8)
+#define SIMD_HW_GATHER (1)					/* gathers are one instruction, not per lane loads */
+typedef __m256  vf32;						/* float lanes */
+typedef __m256i vi32;						/* int lanes */
+typedef __m256  vm32;						/* lane mask */
+
+static inline vf32 vLoad(const float32_t* p) { return _mm256_loadu_ps(p); }
+static inline void vStore(float32_t* p, vf32 a) { _mm256_storeu_ps(p, a); }
+static inline vf32 vSet1(float32_t a) { return _mm256_set1_ps(a); }
+static inline vf32 vAdd(vf32 a, vf32 b) { return _mm256_add_ps(a, b); }
+static inline vf32 vSub(vf32 a, vf32 b) { return _mm256_sub_ps(a, b); }
+static inline vf32 vMul(vf32 a, vf32 b) { return _mm256_mul_ps(a, b); }
+static inline vf32 vDiv(vf32 a, vf32 b) { return _mm256_div_ps(a, b); }
+static inline vf32 vFmadd(vf32 a, vf32 b, vf32 c) { return _mm256_fmadd_ps(a, b, c); }
+static inline vf32 vSqrt(vf32 a) { return _mm256_sqrt_ps(a); }
+static inline vf32 vMin(vf32 a, vf32 b) { return _mm256_min_ps(a, b); }
+static inline vf32 vMax(vf32 a, vf32 b) { return _mm256_max_ps(a, b); }
+static inline vf32 vAbs(vf32 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0F), a); }
+static inline vf32 vFloor(vf32 a) { return _mm256_floor_ps(a); }
+static inline vm32 vCmpGt(vf32 a, vf32 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vm32 vCmpLt(vf32 a, vf32 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline vm32 vCmpGe(vf32 a, vf32 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline vm32 vCmpLe(vf32 a, vf32 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline vm32 vmAnd(vm32 a, vm32 b) { return _mm256_and_ps(a, b); }
+static inline vm32 vmOr(vm32 a, vm32 b) { return _mm256_or_ps(a, b); }
+static inline bool vmAny(vm32 a) { return 0 != _mm256_movemask_ps(a); }
+static inline bool vmAll(vm32 a) { return 0xFF == _mm256_movemask_ps(a); }
+static inline vf32 vSelect(vm32 m, vf32 a, vf32 b) { return _mm256_blendv_ps(b, a, m); }
+
+static inline vi32 viSet1(int32_t a) { return _mm256_set1_epi32(a); }
+static inline vi32 viLoad(const int32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void viStore(int32_t* p, vi32 a) { _mm256_storeu_si256((__m256i*)p, a); }
+static inline vi32 viAdd(vi32 a, vi32 b) { return _mm256_add_epi32(a, b); }
+static inline vi32 viMul(vi32 a, vi32 b) { return _mm256_mullo_epi32(a, b); }
+static inline vi32 viMin(vi32 a, vi32 b) { return _mm256_min_epi32(a, b); }
+static inline vi32 viMax(vi32 a, vi32 b) { return _mm256_max_epi32(a, b); }
+static inline vi32 vCvtTrunc(vf32 a) { return _mm256_cvttps_epi32(a); }
+static inline vf32 vCvtI2F(vi32 a) { return _mm256_cvtepi32_ps(a); }
+static inline vf32 vGather(const float32_t* base, vi32 idx) { return _mm256_i32gather_ps(base, idx, 4); }
+static inline vi32 viSub(vi32 a, vi32 b) { return _mm256_sub_epi32(a, b); }
+static inline vi32 viAnd(vi32 a, vi32 b) { return _mm256_and_si256(a, b); }
+static inline vi32 viOr(vi32 a, vi32 b) { return _mm256_or_si256(a, b); }
+static inline vi32 viSrl(vi32 a, int32_t n) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vi32 viSll(vi32 a, int32_t n) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vi32 viCmpEq(vi32 a, vi32 b) { return _mm256_cmpeq_epi32(a, b); }
+static inline vi32 viCmpGt(vi32 a, vi32 b) { return _mm256_cmpgt_epi32(a, b); }
+static inline vi32 viFromMask(vm32 m) { return _mm256_castps_si256(m); }
+static inline bool viAny(vi32 m) { return 0 != _mm256_movemask_epi8(m); }
+/* 4 bytes at base + ofs (byte offset) per lane */
+static inline vi32 viGatherU8x4(const uint8_t* base, vi32 ofs) { return _mm256_i32gather_epi32((const int*)base, ofs, 1); }
+static inline vi32 viLoadU16(const uint16_t* p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)); }
+/* store lanes holding 0..255 as bytes */
+static inline void viStoreU8(uint8_t* p, vi32 a)
+{
+	__m128i p16 = _mm_packus_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+	_mm_storel_epi64((__m128i*)p, _mm_packus_epi16(p16, p16));
+}
+/* store lanes holding 0..65535 as uint16 */
+static inline void viStoreU16(uint16_t* p, vi32 a)
+{
+	_mm_storeu_si128((__m128i*)p, _mm_packus_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1)));
+}
+
+#define SIMD_WIDTH_F64 (4)					/* double lanes */
+typedef __m256d vf64;
+static inline vf64 vdLoad(const float64_t* p) { return _mm256_loadu_pd(p); }
+static inline void vdStore(float64_t* p, vf64 a) { _mm256_storeu_pd(p, a); }
+static inline vf64 vdSet1(float64_t a) { return _mm256_set1_pd(a); }
+static inline vf64 vdAdd(vf64 a, vf64 b) { return _mm256_add_pd(a, b); }
+static inline vf64 vdMul(vf64 a, vf64 b) { return _mm256_mul_pd(a, b); }
+static inline vf64 vdFmadd(vf64 a, vf64 b, vf64 c) { return _mm256_fmadd_pd(a, b, c); }
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH (4)
+#define SIMD_HW_GATHER (0)
+typedef __m128  vf32;
+typedef __m128i vi32;
+typedef __m128  vm32;
+
+static inline vf32 vLoad(const float32_t* p) { return _mm_loadu_ps(p); }
+static inline void vStore(float32_t* p, vf32 a) { _mm_storeu_ps(p, a); }
+static inline vf32 vSet1(float32_t a) { return _mm_set1_ps(a); }
+static inline vf32 vAdd(vf32 a, vf32 b) { return _mm_add_ps(a, b); }
+static inline vf32 vSub(vf32 a, vf32 b) { return _mm_sub_ps(a, b); }
+static inline vf32 vMul(vf32 a, vf32 b) { return _mm_mul_ps(a, b); }
+static inline vf32 vDiv(vf32 a, vf32 b) { return _mm_div_ps(a, b); }
+static inline vf32 vFmadd(vf32 a, vf32 b, vf32 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline vf32 vSqrt(vf32 a) { return _mm_sqrt_ps(a); }
+static inline vf32 vMin(vf32 a, vf32 b) { return _mm_min_ps(a, b); }
+static inline vf32 vMax(vf32 a, vf32 b) { return _mm_max_ps(a, b); }
+static inline vf32 vAbs(vf32 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0F), a); }
+static inline vm32 vCmpGt(vf32 a, vf32 b) { return _mm_cmpgt_ps(a, b); }
+static inline vm32 vCmpLt(vf32 a, vf32 b) { return _mm_cmplt_ps(a, b); }
+static inline vm32 vCmpGe(vf32 a, vf32 b) { return _mm_cmpge_ps(a, b); }
+static inline vm32 vCmpLe(vf32 a, vf32 b) { return _mm_cmple_ps(a, b); }
+static inline vm32 vmAnd(vm32 a, vm32 b) { return _mm_and_ps(a, b); }
+static inline vm32 vmOr(vm32 a, vm32 b) { return _mm_or_ps(a, b); }
+static inline bool vmAny(vm32 a) { return 0 != _mm_movemask_ps(a); }
+static inline bool vmAll(vm32 a) { return 0xF == _mm_movemask_ps(a); }
+static inline vf32 vSelect(vm32 m, vf32 a, vf32 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+static inline vi32 viSet1(int32_t a) { return _mm_set1_epi32(a); }
+static inline vi32 viLoad(const int32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void viStore(int32_t* p, vi32 a) { _mm_storeu_si128((__m128i*)p, a); }
+static inline vi32 viAdd(vi32 a, vi32 b) { return _mm_add_epi32(a, b); }
+static inline vi32 viMul(vi32 a, vi32 b)
+{
+	/* SSE2 has no 32 bit mullo, multiply even and odd lanes separately */
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+	                          _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+static inline vi32 viMin(vi32 a, vi32 b)
+{
+	__m128i m = _mm_cmplt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+static inline vi32 viMax(vi32 a, vi32 b)
+{
+	__m128i m = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+static inline vi32 vCvtTrunc(vf32 a) { return _mm_cvttps_epi32(a); }
+static inline vf32 vCvtI2F(vi32 a) { return _mm_cvtepi32_ps(a); }
+static inline vf32 vFloor(vf32 a)
+{
+	/* truncate, then step down where truncation rounded up (negative inputs) */
+	vf32 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+	return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0F)));
+}
+static inline vf32 vGather(const float32_t* base, vi32 idx)
+{
+	int32_t i[4];
+	_mm_storeu_si128((__m128i*)i, idx);
+	return _mm_setr_ps(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+}
+static inline vi32 viSub(vi32 a, vi32 b) { return _mm_sub_epi32(a, b); }
+static inline vi32 viAnd(vi32 a, vi32 b) { return _mm_and_si128(a, b); }
+static inline vi32 viOr(vi32 a, vi32 b) { return _mm_or_si128(a, b); }
+static inline vi32 viSrl(vi32 a, int32_t n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vi32 viSll(vi32 a, int32_t n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vi32 viCmpEq(vi32 a, vi32 b) { return _mm_cmpeq_epi32(a, b); }
+static inline vi32 viCmpGt(vi32 a, vi32 b) { return _mm_cmpgt_epi32(a, b); }
+static inline vi32 viFromMask(vm32 m) { return _mm_castps_si128(m); }
+static inline bool viAny(vi32 m) { return 0 != _mm_movemask_epi8(m); }
+static inline vi32 viGatherU8x4(const uint8_t* base, vi32 ofs)
+{
+	int32_t i[4], v[4];
+	_mm_storeu_si128((__m128i*)i, ofs);
+	for (int32_t lane = 0; lane < 4; lane++)
+	{
+		memcpy(v + lane, base + i[lane], 4);
+	}
+	return _mm_loadu_si128((const __m128i*)v);
+}
+static inline vi32 viLoadU16(const uint16_t* p) { return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128()); }
+static inline void viStoreU8(uint8_t* p, vi32 a)
+{
+	__m128i p16 = _mm_packs_epi32(a, a);
+	int32_t v = _mm_cvtsi128_si32(_mm_packus_epi16(p16, p16));
+	memcpy(p, &v, 4);
+}
+static inline void viStoreU16(uint16_t* p, vi32 a)
+{
+	/* SSE2 only packs signed, shift to int16 range and back */
+	__m128i p16 = _mm_packs_epi32(_mm_sub_epi32(a, _mm_set1_epi32(32768)), _mm_setzero_si128());
+	_mm_storel_epi64((__m128i*)p, _mm_xor_si128(p16, _mm_set1_epi16(-32768)));
+}
+
+#define SIMD_WIDTH_F64 (2)
+typedef __m128d vf64;
+static inline vf64 vdLoad(const float64_t* p) { return _mm_loadu_pd(p); }
+static inline void vdStore(float64_t* p, vf64 a) { _mm_storeu_pd(p, a); }
+static inline vf64 vdSet1(float64_t a) { return _mm_set1_pd(a); }
+static inline vf64 vdAdd(vf64 a, vf64 b) { return _mm_add_pd(a, b); }
+static inline vf64 vdMul(vf64 a, vf64 b) { return _mm_mul_pd(a, b); }
+static inline vf64 vdFmadd(vf64 a, vf64 b, vf64 c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+
+#else
+#define SIMD_WIDTH (1)
+#define SIMD_HW_GATHER (0)
+typedef float32_t vf32;
+typedef int32_t   vi32;
+typedef bool      vm32;
+
+static inline vf32 vLoad(const float32_t* p) { return *p; }
+static inline void vStore(float32_t* p, vf32 a) { *p = a; }
+static inline vf32 vSet1(float32_t a) { return a; }
+static inline vf32 vAdd(vf32 a, vf32 b) { return a + b; }
+static inline vf32 vSub(vf32 a, vf32 b) { return a - b; }
+static inline vf32 vMul(vf32 a, vf32 b) { return a * b; }
+static inline vf32 vDiv(vf32 a, vf32 b) { return a / b; }
+static inline vf32 vFmadd(vf32 a, vf32 b, vf32 c) { return a * b + c; }
+static inline vf32 vSqrt(vf32 a) { return sqrtf(a); }
+static inline vf32 vMin(vf32 a, vf32 b) { return MIN(a, b); }
+static inline vf32 vMax(vf32 a, vf32 b) { return MAX(a, b); }
+static inline vf32 vAbs(vf32 a) { return fabsf(a); }
+static inline vf32 vFloor(vf32 a) { return floorf(a); }
+static inline vm32 vCmpGt(vf32 a, vf32 b) { return a > b; }
+static inline vm32 vCmpLt(vf32 a, vf32 b) { return a < b; }
+static inline vm32 vCmpGe(vf32 a, vf32 b) { return a >= b; }
+static inline vm32 vCmpLe(vf32 a, vf32 b) { return a <= b; }
+static inline vm32 vmAnd(vm32 a, vm32 b) { return a && b; }
+static inline vm32 vmOr(vm32 a, vm32 b) { return a || b; }
+static inline bool vmAny(vm32 a) { return a; }
+static inline bool vmAll(vm32 a) { return a; }
+static inline vf32 vSelect(vm32 m, vf32 a, vf32 b) { return m ? a : b; }
+
+static inline vi32 viSet1(int32_t a) { return a; }
+static inline vi32 viLoad(const int32_t* p) { return *p; }
+static inline void viStore(int32_t* p, vi32 a) { *p = a; }
+static inline vi32 viAdd(vi32 a, vi32 b) { return a + b; }
+static inline vi32 viMul(vi32 a, vi32 b) { return a * b; }
+static inline vi32 viMin(vi32 a, vi32 b) { return MIN(a, b); }
+static inline vi32 viMax(vi32 a, vi32 b) { return MAX(a, b); }
+static inline vi32 vCvtTrunc(vf32 a) { return (int32_t)a; }
+static inline vf32 vCvtI2F(vi32 a) { return (float32_t)a; }
+static inline vf32 vGather(const float32_t* base, vi32 idx) { return base[idx]; }
+static inline vi32 viSub(vi32 a, vi32 b) { return a - b; }
+static inline vi32 viAnd(vi32 a, vi32 b) { return a & b; }
+static inline vi32 viOr(vi32 a, vi32 b) { return a | b; }
+static inline vi32 viSrl(vi32 a, int32_t n) { return int32_t(uint32_t(a) >> n); }
+static inline vi32 viSll(vi32 a, int32_t n) { return int32_t(uint32_t(a) << n); }
+static inline vi32 viCmpEq(vi32 a, vi32 b) { return (a == b) ? -1 : 0; }
+static inline vi32 viCmpGt(vi32 a, vi32 b) { return (a > b) ? -1 : 0; }
+static inline vi32 viFromMask(vm32 m) { return m ? -1 : 0; }
+static inline bool viAny(vi32 m) { return 0 != m; }
+static inline vi32 viGatherU8x4(const uint8_t* base, vi32 ofs) { int32_t v; memcpy(&v, base + ofs, 4); return v; }
+static inline vi32 viLoadU16(const uint16_t* p) { return *p; }
+static inline void viStoreU8(uint8_t* p, vi32 a) { *p = uint8_t(a); }
+static inline void viStoreU16(uint16_t* p, vi32 a) { uint16_t v = uint16_t(a); memcpy(p, &v, 2); }
+
+#define SIMD_WIDTH_F64 (1)
+typedef float64_t vf64;
+static inline vf64 vdLoad(const float64_t* p) { return *p; }
+static inline void vdStore(float64_t* p, vf64 a) { *p = a; }
+static inline vf64 vdSet1(float64_t a) { return a; }
+static inline vf64 vdAdd(vf64 a, vf64 b) { return a + b; }
+static inline vf64 vdMul(vf64 a, vf64 b) { return a * b; }
+static inline vf64 vdFmadd(vf64 a, vf64 b, vf64 c) { return a * b + c; }
+#endif
+
+/**
+* @brief atan2(y, x) for y >= 0, result in [0, PI]
+*        cephes atanf polynomial after reduction to |t| <= tan(PI/8),
+*        max error about 1e-7 rad
+* @param y [in] non-negative numerator
+* @param x [in] denominator
+* @return angle, in rad
+*/
+static inline vf32 vAtan2Pos(vf32 y, vf32 x)
+{
+	vf32 ax = vAbs(x);
+	vf32 mx = vMax(y, ax);
+	vf32 mn = vMin(y, ax);
+	/* y == x == 0 gives 0 rather than NaN */
+	vf32 t = vDiv(mn, vMax(mx, vSet1(1e-30F)));
+	/* t in [0, 1], fold (tan(PI/8), 1] around PI/4 */
+	vm32 big = vCmpGt(t, vSet1(0.41421356F));
+	t = vSelect(big, vDiv(vSub(t, vSet1(1.0F)), vAdd(t, vSet1(1.0F))), t);
+	vf32 z = vMul(t, t);
+	vf32 p = vSet1(8.05374449538e-2F);
+	p = vFmadd(p, z, vSet1(-1.38776856032e-1F));
+	p = vFmadd(p, z, vSet1(1.99777106478e-1F));
+	p = vFmadd(p, z, vSet1(-3.33329491539e-1F));
+	vf32 a = vFmadd(vMul(p, z), t, t);
+	a = vSelect(big, vAdd(a, vSet1(float32_t(PI / 4))), a);
+	/* undo octant folding */
+	a = vSelect(vCmpGt(y, ax), vSub(vSet1(float32_t(PI / 2)), a), a);
+	a = vSelect(vCmpLt(x, vSet1(0.0F)), vSub(vSet1(float32_t(PI)), a), a);
+	return a;
+}
+
+/**
+* @brief sin and cos of theta in [0, PI]
+*        evaluated around PI/2, where both series converge fast,
+*        max error about 1e-7
+* @param theta [in]  angle, in rad, clamped to [0, PI]
+* @param s     [out] sin(theta)
+* @param c     [out] cos(theta)
+* @return void return
+*/
+static inline void vSinCosPos(vf32 theta, vf32* s, vf32* c)
+{
+	theta = vMin(vMax(theta, vSet1(0.0F)), vSet1(float32_t(PI)));
+	vf32 x = vSub(theta, vSet1(float32_t(PI / 2)));
+	vf32 x2 = vMul(x, x);
+	/* sin(x), x in [-PI/2, PI/2] */
+	vf32 ps = vSet1(-2.5052108e-8F);
+	ps = vFmadd(ps, x2, vSet1(2.7557319e-6F));
+	ps = vFmadd(ps, x2, vSet1(-1.9841270e-4F));
+	ps = vFmadd(ps, x2, vSet1(8.3333333e-3F));
+	ps = vFmadd(ps, x2, vSet1(-1.6666667e-1F));
+	ps = vFmadd(vMul(ps, x2), x, x);
+	/* cos(x), x in [-PI/2, PI/2] */
+	vf32 pc = vSet1(2.0876757e-9F);
+	pc = vFmadd(pc, x2, vSet1(-2.7557319e-7F));
+	pc = vFmadd(pc, x2, vSet1(2.4801587e-5F));
+	pc = vFmadd(pc, x2, vSet1(-1.3888889e-3F));
+	pc = vFmadd(pc, x2, vSet1(4.1666667e-2F));
+	pc = vFmadd(pc, x2, vSet1(-0.5F));
+	pc = vFmadd(pc, x2, vSet1(1.0F));
+	/* sin(theta) = cos(x), cos(theta) = -sin(x) */
+	*s = pc;
+	*c = vSub(vSet1(0.0F), ps);
+	return;
+}
+#endif
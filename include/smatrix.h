@@ -0,0 +1,475 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: fixed size matrices for small solves, the size is known at
+*              compile time and the storage lives on the stack, so a fit
+*              builds and solves its normal equations without touching the heap
+*/
+#ifndef __DEFINE_SMATRIX__
+#define __DEFINE_SMATRIX__
+#include "matrix.h"
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+/**
+* @brief call func(std::integral_constant<int, I>()) for I = 0 ... N-1,
+*        the loop is unrolled at compile time and I is a constant in func
+* @param func [in] generic callable taking the index
+*/
+template <typename Func, int... I>
+inline void staticForImpl(Func&& func, std::integer_sequence<int, I...>)
+{
+	(func(std::integral_constant<int, I>()), ...);
+}
+
+template <int N, typename Func>
+inline void staticFor(Func&& func)
+{
+	staticForImpl(func, std::make_integer_sequence<int, N>());
+}
+
+/**
+* R x C double matrix, row major on the stack
+* rows and cols are constexpr, element access matches Matrix, m[i][j]
+*/
+template <int R, int C>
+class SMatrix
+{
+	static_assert((R > 0) && (C > 0), "SMatrix size must be positive");
+public:
+	SMatrix() : data() {}
+
+	/**
+	* @brief copy a Matrix, elements outside of m are set to 0
+	* @param m [in] matrix, usually R x C
+	*/
+	explicit SMatrix(const Matrix& m) : data()
+	{
+		int r = (m.rows() < R) ? m.rows() : R;
+		int c = (m.cols() < C) ? m.cols() : C;
+		for (int i = 0; i < r; ++i)
+		{
+			for (int j = 0; j < c; ++j)
+			{
+				data[i][j] = m[i][j];
+			}
+		}
+	}
+
+	/**
+	* @brief copy to a Matrix
+	* @return R x C Matrix
+	*/
+	Matrix toMatrix() const
+	{
+		Matrix m(R, C);
+		for (int i = 0; i < R; ++i)
+		{
+			for (int j = 0; j < C; ++j)
+			{
+				m[i][j] = data[i][j];
+			}
+		}
+		return m;
+	}
+
+	static constexpr int rows() { return R; }
+	static constexpr int cols() { return C; }
+
+	double* operator[](int row) { return data[row]; }
+	const double* operator[](int row) const { return data[row]; }
+
+	static SMatrix eye()
+	{
+		static_assert(R == C, "SMatrix::eye needs a square matrix");
+		SMatrix m;
+		for (int i = 0; i < R; ++i)
+		{
+			m[i][i] = 1.0;
+		}
+		return m;
+	}
+
+	SMatrix& operator+=(const SMatrix& m)
+	{
+		for (int i = 0; i < R; ++i)
+		{
+			for (int j = 0; j < C; ++j)
+			{
+				data[i][j] += m[i][j];
+			}
+		}
+		return *this;
+	}
+
+	SMatrix& operator-=(const SMatrix& m)
+	{
+		for (int i = 0; i < R; ++i)
+		{
+			for (int j = 0; j < C; ++j)
+			{
+				data[i][j] -= m[i][j];
+			}
+		}
+		return *this;
+	}
+
+	SMatrix& operator*=(double s)
+	{
+		for (int i = 0; i < R; ++i)
+		{
+			for (int j = 0; j < C; ++j)
+			{
+				data[i][j] *= s;
+			}
+		}
+		return *this;
+	}
+
+private:
+	double data[R][C];
+};
+
+template <int R, int C>
+SMatrix<R, C> operator+(SMatrix<R, C> lhs, const SMatrix<R, C>& rhs)
+{
+	return lhs += rhs;
+}
+
+template <int R, int C>
+SMatrix<R, C> operator-(SMatrix<R, C> lhs, const SMatrix<R, C>& rhs)
+{
+	return lhs -= rhs;
+}
+
+template <int R, int C>
+SMatrix<R, C> operator*(SMatrix<R, C> lhs, double s)
+{
+	return lhs *= s;
+}
+
+template <int R, int K, int C>
+SMatrix<R, C> operator*(const SMatrix<R, K>& lhs, const SMatrix<K, C>& rhs)
+{
+	SMatrix<R, C> m;
+	for (int i = 0; i < R; ++i)
+	{
+		for (int k = 0; k < K; ++k)
+		{
+			const double a = lhs[i][k];
+			for (int j = 0; j < C; ++j)
+			{
+				m[i][j] += a * rhs[k][j];
+			}
+		}
+	}
+	return m;
+}
+
+template <int R, int C>
+SMatrix<C, R> trans(const SMatrix<R, C>& m)
+{
+	SMatrix<C, R> ret;
+	for (int i = 0; i < C; ++i)
+	{
+		for (int j = 0; j < R; ++j)
+		{
+			ret[i][j] = m[j][i];
+		}
+	}
+	return ret;
+}
+
+/**
+* partial pivot LU decomposition of a fixed size matrix, PA = LU
+* same algorithm and results as LUDecomp, the pivot loop is unrolled
+*/
+template <int N>
+class SLUDecomp
+{
+public:
+	SLUDecomp() : sign(1), valid(false) {}
+	explicit SLUDecomp(const SMatrix<N, N>& m) : sign(1), valid(false) { compute(m); }
+
+	/**
+	* @brief decompose a square matrix
+	* @param m [in] square matrix
+	* @return false if m is singular
+	*/
+	bool compute(const SMatrix<N, N>& m)
+	{
+		lu = m;
+		sign = 1;
+		valid = true;
+		for (int i = 0; i < N; ++i)
+		{
+			perm[i] = i;
+		}
+
+		staticFor<N>([&](auto kIdx)
+		{
+			constexpr int k = decltype(kIdx)::value;
+			if (!valid)
+			{
+				return;
+			}
+
+			int p = k;
+			for (int i = k + 1; i < N; ++i)
+			{
+				if (fabs(lu[p][k]) < fabs(lu[i][k]))
+				{
+					p = i;
+				}
+			}
+			if (fabs(lu[p][k]) < 1e-20)
+			{
+				valid = false;
+				return;
+			}
+
+			if (p != k)
+			{
+				for (int j = 0; j < N; ++j)
+				{
+					double t = lu[k][j];
+					lu[k][j] = lu[p][j];
+					lu[p][j] = t;
+				}
+				int t = perm[k];
+				perm[k] = perm[p];
+				perm[p] = t;
+				sign = -sign;
+			}
+
+			for (int i = k + 1; i < N; ++i)
+			{
+				lu[i][k] /= lu[k][k];
+				const double q = lu[i][k];
+				for (int j = k + 1; j < N; ++j)
+				{
+					lu[i][j] -= q * lu[k][j];
+				}
+			}
+		});
+		return valid;
+	}
+
+	bool ok() const { return valid; }
+
+	/**
+	* @brief solve A * X = B
+	* @param B [in] right-hand sides, one per column
+	* @return X, undefined if the decomposition failed
+	*/
+	template <int C>
+	SMatrix<N, C> solve(const SMatrix<N, C>& B) const
+	{
+		SMatrix<N, C> X;
+		for (int i = 0; i < N; ++i)
+		{
+			for (int j = 0; j < C; ++j)
+			{
+				X[i][j] = B[perm[i]][j];
+			}
+		}
+
+		for (int i = 1; i < N; ++i)
+		{
+			for (int k = 0; k < i; ++k)
+			{
+				const double q = lu[i][k];
+				for (int j = 0; j < C; ++j)
+				{
+					X[i][j] -= q * X[k][j];
+				}
+			}
+		}
+
+		for (int i = N - 1; i >= 0; --i)
+		{
+			for (int k = i + 1; k < N; ++k)
+			{
+				const double q = lu[i][k];
+				for (int j = 0; j < C; ++j)
+				{
+					X[i][j] -= q * X[k][j];
+				}
+			}
+			for (int j = 0; j < C; ++j)
+			{
+				X[i][j] /= lu[i][i];
+			}
+		}
+		return X;
+	}
+
+	double det() const
+	{
+		if (!valid)
+		{
+			return 0.0;
+		}
+		double ret = sign;
+		for (int i = 0; i < N; ++i)
+		{
+			ret *= lu[i][i];
+		}
+		return ret;
+	}
+
+private:
+	SMatrix<N, N> lu;		/* L below the diagonal (unit diagonal not stored), U on and above */
+	int perm[N];			/* row i comes from row perm[i] of A */
+	int sign;				/* parity of the row swaps, 1 or -1 */
+	bool valid;
+};
+
+/**
+* Cholesky decomposition of a fixed size symmetric positive definite
+* matrix, A = LL^T, same algorithm and results as CholeskyDecomp, the
+* column loop is unrolled
+*/
+template <int N>
+class SCholeskyDecomp
+{
+public:
+	SCholeskyDecomp() : valid(false) {}
+	explicit SCholeskyDecomp(const SMatrix<N, N>& m) : valid(false) { compute(m); }
+
+	/**
+	* @brief decompose a square matrix, only the lower triangle is read
+	* @param m [in] square matrix
+	* @return false if m is not positive definite
+	*/
+	bool compute(const SMatrix<N, N>& m)
+	{
+		L = SMatrix<N, N>();
+		valid = true;
+
+		staticFor<N>([&](auto jIdx)
+		{
+			constexpr int j = decltype(jIdx)::value;
+			if (!valid)
+			{
+				return;
+			}
+
+			double d = m[j][j];
+			for (int k = 0; k < j; ++k)
+			{
+				d -= L[j][k] * L[j][k];
+			}
+			if (!(d > 0.0))
+			{
+				valid = false;
+				return;
+			}
+			L[j][j] = sqrt(d);
+
+			for (int i = j + 1; i < N; ++i)
+			{
+				double s = m[i][j];
+				for (int k = 0; k < j; ++k)
+				{
+					s -= L[i][k] * L[j][k];
+				}
+				L[i][j] = s / L[j][j];
+			}
+		});
+		return valid;
+	}
+
+	bool ok() const { return valid; }
+
+	/**
+	* @brief solve A * X = B by L * Y = B then L^T * X = Y
+	* @param B [in] right-hand sides, one per column
+	* @return X, undefined if the decomposition failed
+	*/
+	template <int C>
+	SMatrix<N, C> solve(const SMatrix<N, C>& B) const
+	{
+		SMatrix<N, C> X = B;
+
+		for (int i = 0; i < N; ++i)
+		{
+			for (int k = 0; k < i; ++k)
+			{
+				const double q = L[i][k];
+				for (int j = 0; j < C; ++j)
+				{
+					X[i][j] -= q * X[k][j];
+				}
+			}
+			for (int j = 0; j < C; ++j)
+			{
+				X[i][j] /= L[i][i];
+			}
+		}
+
+		for (int i = N - 1; i >= 0; --i)
+		{
+			for (int k = i + 1; k < N; ++k)
+			{
+				const double q = L[k][i];
+				for (int j = 0; j < C; ++j)
+				{
+					X[i][j] -= q * X[k][j];
+				}
+			}
+			for (int j = 0; j < C; ++j)
+			{
+				X[i][j] /= L[i][i];
+			}
+		}
+		return X;
+	}
+
+private:
+	SMatrix<N, N> L;		/* lower triangle */
+	bool valid;
+};
+
+/**
+* @brief solve A * X = B with partial pivot LU
+* @param A [in]  square matrix
+* @param B [in]  right-hand sides, one per column
+* @param X [out] solution
+* @return false if A is singular
+*/
+template <int N, int C>
+bool solve(const SMatrix<N, N>& A, const SMatrix<N, C>& B, SMatrix<N, C>& X)
+{
+	SLUDecomp<N> lu(A);
+	if (!lu.ok())
+	{
+		return false;
+	}
+	X = lu.solve(B);
+	return true;
+}
+
+/**
+* @brief solve A * X = B for symmetric positive definite A with Cholesky,
+*        falls back to LU when the Cholesky decomposition breaks down
+* @param A [in]  symmetric positive definite matrix
+* @param B [in]  right-hand sides, one per column
+* @param X [out] solution
+* @return false if A is singular
+*/
+template <int N, int C>
+bool solveSPD(const SMatrix<N, N>& A, const SMatrix<N, C>& B, SMatrix<N, C>& X)
+{
+	SCholeskyDecomp<N> chol(A);
+	if (chol.ok())
+	{
+		X = chol.solve(B);
+		return true;
+	}
+	return solve(A, B, X);
+}
+#endif
@@ -1,11 +1,15 @@
 #include "CameraModelTransfer.h"
 #include "KannalaBrandt.h"
+#include "Remap.h"
+#include "ModelFile.h"
 #include <string>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
 #include <opencv2/highgui.hpp>
 using namespace cv;
-CamInt* pCamIntUni = new CamInt;
-int helpFlag = 0;
-CFG_CMT gCFG;
 int main(int argc, char* argv[])
 {
 	/* validate inputs */
@@ -15,21 +19,21 @@ int main(int argc, char* argv[])
 	}
 
 	/* load config file */
-	if(false == extractCfg(gCFG,argv))
+	ConversionContext ctx;
+	if(false == extractCfg(ctx.cfg,argv))
 	{
 		CLOG_E("Could not extract required config term in the config file!\n");
 		return 0;
 	}
 
 	/* decide transformation mode */
-	CameraModel mode = UNIVERSAL;
-	if(gCFG._target_model_type == "UNIVERSAL")
+	if(ctx.cfg._target_model_type == "UNIVERSAL")
 	{
-		mode = UNIVERSAL;
+		ctx.mode = UNIVERSAL;
 	}
-	else if(gCFG._target_model_type == "KANNALA_BRANDT")
+	else if(ctx.cfg._target_model_type == "KANNALA_BRANDT")
 	{
-		mode = KANNALA_BRANDT;
+		ctx.mode = KANNALA_BRANDT;
 	}
 	else
 	{
@@ -37,24 +41,47 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
+	/* batch mode, every model of _batch_input in this process */
+	if("NULL" != ctx.cfg._batch_input)
+	{
+		return (0 == modelBatch(&ctx)) ? 1 : 0;
+	}
+
 	/* Load original camera model */
-	*pCamIntUni = loadCamInts(gCFG._path_to_ori_model.c_str());
+	ctx.oriCam = loadCamInts(ctx.cfg._path_to_ori_model.c_str());
+	if (ctx.oriCam.dRadius.empty())
+	{
+		CLOG_E("Could not load camera model %s\n", ctx.cfg._path_to_ori_model.c_str());
+		return 0;
+	}
 
 	/* model transfer */
-	void* model = NULL;
-	model = modelTransfer(mode, pCamIntUni);
+	ctx.model = modelTransfer(ctx.mode, &ctx.oriCam, ctx.cfg._curve_tolerance, ctx.cfg._kb_order);
 
 	/* save model file */
-	modelSave(gCFG._path_to_save_model.c_str(), model, mode);
+	modelSave(&ctx);
+
+	/* remap maps */
+	if("NULL" != ctx.cfg._remap_type)
+	{
+		modelRemap(&ctx);
+	}
 	
-	if("true" == gCFG._show_offset)
+	if("true" == ctx.cfg._show_offset)
 	{
-		modelShow(pCamIntUni, model);
+		modelShow(&ctx);
 	}
-	delete pCamIntUni->dCurve;
 	return 1;
 }
 
+/**
+* DeConstructor, release the original and the transfered models
+*/
+_CONVERSION_CONTEXT::~_CONVERSION_CONTEXT()
+{
+	releaseModel(model, mode);
+}
+
 /**
  * @brief validate inputs
  * @param argc [in] number of input arguments 
@@ -106,28 +133,42 @@ static bool inputValid(int argc, char** argv)
 */
 static void printHelp()
 {
-	if (0 == helpFlag)
-	{
-		printf("-------------------------------------------------------\n");
-		printf("Usage: ./CamTransfer configFile\n");
-		printf("-------------------------------------------------------\n");
-		printf("# Before you start using this tool, please prepare a \n  config contains following config terms:\n");
-		printf("# _help                 print help message or not, could \n                        be [tree] or [false]\n");
-		printf("# _path_to_ori_model    required, path to model to be \n                        transfered\n");
-		printf("# _path_to_save_model   optional, path to save calculated \n                        model\n");
-		printf("# _target_model_type    target model type, could be:\n");
-		printf("#                       1. UNIVERSAL\n");
-		printf("#                       2. KANNALA_BRANDT\n");
-		printf("# _show_offset          show disortion curve offset or \n                        not,could be [tree] or [false]\n");
-		printf("# _log_level = 0        log print level,could be:\n");
-		printf("#                       0   print nothing\n");
-		printf("#                       1   print result only\n");
-		printf("#                       2   print everything\n");
-		printf("# _curve_size           Curve size, could be [NULL] or \n                        [a number], by default, it is 1001\n");
-		printf("# _curve_step = NULL    Curve step(angle), coule be [NULL] \n                        or [a number], by default, it is 0.1 degree\n");
-		printf("-------------------------------------------------------\n");
-		helpFlag = 1;
-	}
+	printf("-------------------------------------------------------\n");
+	printf("Usage: ./CamTransfer configFile\n");
+	printf("-------------------------------------------------------\n");
+	printf("# Before you start using this tool, please prepare a \n  config contains following config terms:\n");
+	printf("# _help                 print help message or not, could \n                        be [tree] or [false]\n");
+	printf("# _path_to_ori_model    required, path to model to be \n                        transfered\n");
+	printf("# _path_to_save_model   optional, path to save calculated \n                        model\n");
+	printf("# _target_model_type    target model type, could be:\n");
+	printf("#                       1. UNIVERSAL\n");
+	printf("#                       2. KANNALA_BRANDT\n");
+	printf("# _show_offset          show disortion curve offset or \n                        not,could be [tree] or [false]\n");
+	printf("# _log_level = 0        log print level,could be:\n");
+	printf("#                       0   print nothing\n");
+	printf("#                       1   print result only\n");
+	printf("#                       2   print everything\n");
+	printf("# _curve_size           Curve size, could be [NULL] or \n                        [a number], by default, it is 1001\n");
+	printf("# _curve_step = NULL    Curve step(angle), coule be [NULL] \n                        or [a number], by default, it is 0.1 degree\n");
+	printf("# _curve_tolerance      max radius error of a UNIVERSAL target,\n                        in mm, its curve keeps only the knots\n                        needed, by default, it is 0 (every point)\n");
+	printf("# _kb_order             number of coef of a KANNALA_BRANDT\n                        target, in [1, %d], by default, it is 5\n", KB_MAX_ORDER);
+	printf("# _remap_type           remap maps to build, could be:\n");
+	printf("#                       1. NULL, no remap maps\n");
+	printf("#                       2. FISHEYE_TO_PINHOLE\n");
+	printf("#                       3. PINHOLE_TO_FISHEYE\n");
+	printf("# _remap_path           path to save remap maps, by default\n                        it is [path to save model]_remap\n");
+	printf("# _remap_fov            horizontal fov of the virtual pinhole,\n                        in degree, by default, it is 90\n");
+	printf("# _remap_threads        number of threads building remap maps,\n                        by default, it is 0 (all cores)\n");
+	printf("# _remap_radial         save a radial lut instead of full maps,\n                        [true] or [false], by default, it is false\n");
+	printf("# _save_format          format of the saved model, could be:\n");
+	printf("#                       1. TEXT, by default\n");
+	printf("#                       2. BINARY, loads without parsing, the\n                        original model may be either format\n");
+	printf("# _batch_input          batch mode, a directory of models or a\n                        manifest with one model path per line,\n                        replaces _path_to_ori_model\n");
+	printf("# _batch_output         directory to save batch models, by\n                        default, it is [batch input]_[target type],\n                        models of the same name get an index\n");
+	printf("# _batch_report         path to save batch summary, by default\n                        it is [batch output]/batch_report.txt\n");
+	printf("# _batch_threads        number of threads converting models,\n                        by default, it is 0 (all cores)\n");
+	printf("#                       _show_offset and _remap_* are ignored\n                        in batch mode\n");
+	printf("-------------------------------------------------------\n");
 	return;
 }
 /**
@@ -139,6 +180,7 @@ static void printHelp()
 static bool extractCfg(CFG_CMT &cfg, char** argv)
 {
 	bool ret = true;
+	bool showHelp = false;		/* print help once, after the messages */
 	CONFIG cfgFile;
 	cfgFile.setConfigGroup(NULL, "NoName");
 	CONFIG_RET_CHECK retCheck = cfgFile.loadConfig(argv[1]);
@@ -180,30 +222,125 @@ static bool extractCfg(CFG_CMT &cfg, char** argv)
 		{
 			cfgFile.extractCfgValue(&cfg._curve_step,"_curve_step","NoName");
 		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_curve_tolerance","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._curve_tolerance,"_curve_tolerance","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_kb_order","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._kb_order,"_kb_order","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_remap_type","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._remap_type,"_remap_type","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_remap_path","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._remap_path,"_remap_path","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_remap_fov","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._remap_fov,"_remap_fov","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_remap_threads","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._remap_threads,"_remap_threads","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_remap_radial","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._remap_radial,"_remap_radial","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_save_format","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._save_format,"_save_format","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_batch_input","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._batch_input,"_batch_input","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_batch_output","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._batch_output,"_batch_output","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_batch_report","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._batch_report,"_batch_report","NoName");
+		}
+		if(CONFIG_RET_SUCCESS != cfgFile.checkCfgValue("_batch_threads","NULL","NoName"))
+		{
+			cfgFile.extractCfgValue(&cfg._batch_threads,"_batch_threads","NoName");
+		}
 
 		if (cfg._help == "true")
 		{
-			printHelp();
+			showHelp = true;
 		}
-		if(cfg._path_to_ori_model == "NULL")
+		if((cfg._path_to_ori_model == "NULL") && (cfg._batch_input == "NULL"))
 		{
 			CLOG_E("Please privide original camera model file\n");
-			printHelp();
+			showHelp = true;
 			ret = false;
 		}
 		
 		if(cfg._target_model_type == "NULL")
 		{
 			CLOG_E("Please specify target model type\n");
-			printHelp();
+			showHelp = true;
+			ret = false;
+		}
+
+		if(cfg._curve_tolerance < 0)
+		{
+			CLOG_E("Invalid curve tolerance %f\n", cfg._curve_tolerance);
+			showHelp = true;
+			ret = false;
+		}
+
+		if((cfg._kb_order < 1) || (cfg._kb_order > KB_MAX_ORDER))
+		{
+			CLOG_E("Invalid KANNALA_BRANDT order %d, should be in [1, %d]\n", cfg._kb_order, KB_MAX_ORDER);
+			showHelp = true;
 			ret = false;
 		}
 
-		if(cfg._path_to_save_model == "NULL")
+		if((cfg._save_format != "TEXT") && (cfg._save_format != "BINARY"))
+		{
+			CLOG_E("Unsupport save format %s\n", cfg._save_format.c_str());
+			showHelp = true;
+			ret = false;
+		}
+
+		if(cfg._batch_input != "NULL")
+		{
+			if(cfg._batch_output == "NULL")
+			{
+				/* next to the input, not inside a directory given with a trailing slash */
+				string input = cfg._batch_input;
+				while((input.size() > 1) && ('/' == input.back()))
+				{
+					input.pop_back();
+				}
+				cfg._batch_output = input+"_"+cfg._target_model_type;
+			}
+			if(cfg._batch_report == "NULL")
+			{
+				cfg._batch_report = cfg._batch_output+"/batch_report.txt";
+			}
+		}
+		else if(cfg._path_to_save_model == "NULL")
 		{
 			cfg._path_to_save_model = cfg._path_to_ori_model+"_"+cfg._target_model_type;
 			CLOG_I(2,"Output camera model will be saved at: \n%s\n",cfg._path_to_save_model.c_str());
 		}
+
+		if((cfg._remap_type != "NULL") && (cfg._remap_path == "NULL"))
+		{
+			cfg._remap_path = cfg._path_to_save_model+"_remap";
+		}
+	}
+	if (showHelp)
+	{
+		printHelp();
 	}
 	return ret;
 }
@@ -216,6 +353,23 @@ static CamInt loadCamInts(const char* path)
 {
 	using namespace std;
 	CamInt cam;
+	if (CTRUE == isModelFile(path))
+	{
+		int32_t type = UNIVERSAL;
+		CamIntKannalaBrandt targetModel;
+		if (CTRUE == loadModelFile(path, &type, &cam, &targetModel))
+		{
+			if (UNIVERSAL == type)
+			{
+				buildRadiusLut(&cam);
+			}
+			else
+			{
+				extractKannalaBrandt(&cam, &targetModel);
+			}
+		}
+		return cam;
+	}
 	CONFIG cfg;
 	cfg.setConfigGroup(NULL, "Global");
 	cfg.loadConfig(path);
@@ -234,8 +388,10 @@ static CamInt loadCamInts(const char* path)
 		cfg.extractCfgValue(&cam.cv, "_CV", "Global");
 		cfg.extractCfgValue(&cam.dStep, "_DISORT_STEP", "Global");
 		cfg.extractCfgValue(&cam.dCurveSize, "_DISORT_SIZE", "Global");
-		cam.dCurve = new float[cam.dCurveSize * 2];
-		cfg.extractCfgValue(cam.dCurve, "_DISORT", "Global");
+		if (CTRUE == loadDisortCurve(cfg, &cam))
+		{
+			buildRadiusLut(&cam);
+		}
 	}
 	else if (type == "KANNALA_BRANDT")
 	{
@@ -270,13 +426,77 @@ static CamInt loadCamInts(const char* path)
 	return cam;
 }
 
+/**
+* @brief read the _DISORT curve straight into new dAngle and dRadius, the
+*        curve must have _DISORT_SIZE rows of angle and radius with the
+*        angle increasing, checked while parsing. angles on the uniform
+*        grid of _DISORT_STEP are dropped
+* @param cfg [in]     loaded camera model config
+* @param cam [in/out] camera model, dStep and dCurveSize are read
+* @return success flag
+*/
+static CFlags loadDisortCurve(CONFIG& cfg, CamInt* cam)
+{
+	const configData* curve = NULL;
+	if (CONFIG_RET_SUCCESS != cfg.findCfgString(curve, "_DISORT", "Global"))
+	{
+		return CFALSE;
+	}
+	if ((cam->dCurveSize < 2) || !(cam->dStep > 0.0F))
+	{
+		CLOG_E("Invalid disortion curve, _DISORT_SIZE %d, _DISORT_STEP %f\n", cam->dCurveSize, cam->dStep);
+		return CFALSE;
+	}
+	if (curve->size() != (size_t)cam->dCurveSize)
+	{
+		CLOG_E("_DISORT has %d rows, _DISORT_SIZE is %d\n", (int32_t)curve->size(), cam->dCurveSize);
+		return CFALSE;
+	}
+
+	CurveBuffer angle2Load(cam->dCurveSize);
+	CurveBuffer radius2Load(cam->dCurveSize);
+	float32_t* pAngle = angle2Load.data();
+	float32_t* pRadius = radius2Load.data();
+	int32_t idxFlat = 0;			/* first point where the radius stops increasing */
+	for (int32_t idx = 0; idx < cam->dCurveSize; idx++)
+	{
+		CONFIG_ELEM_ROW<string_view> row = (*curve)[idx];
+		if ((2 != row.size()) || !temp::cfgToNumber(row[0], pAngle + idx) || !temp::cfgToNumber(row[1], pRadius + idx))
+		{
+			CLOG_E("_DISORT row %d is not an angle and a radius\n", idx);
+			return CFALSE;
+		}
+		if ((idx > 0) && !(pAngle[idx] > pAngle[idx - 1]))
+		{
+			CLOG_E("_DISORT angle is not increasing at row %d\n", idx);
+			return CFALSE;
+		}
+		if ((idx > 0) && (0 == idxFlat) && !(pRadius[idx] > pRadius[idx - 1]))
+		{
+			idxFlat = idx;
+		}
+	}
+	if (idxFlat > 0)
+	{
+		CLOG_I(1, "_DISORT radius stops increasing at row %d, the inverse curve ends there\n", idxFlat);
+	}
+
+	cam->dAngle = std::move(angle2Load);
+	cam->dRadius = std::move(radius2Load);
+	dropUniformAngles(cam);
+	return CTRUE;
+}
+
 /**
 * @brief transfer camera model
-* @param type [in] target camera model type, align with [TargetCameraModel]
-* @param cam  [in] origin cam ints
+* @param type      [in] target camera model type, align with [TargetCameraModel]
+* @param cam       [in] origin cam ints
+* @param tolerance [in] max radius error of a resampled UNIVERSAL curve, in mm,
+*                       0 keeps every point
+* @param kbOrder   [in] number of coef of a KANNALA_BRANDT target
 * @return pointer to result
 */
-static void* modelTransfer(int32_t type, CamInt* cam)
+static void* modelTransfer(int32_t type, CamInt* cam, float32_t tolerance, int32_t kbOrder)
 {
 	void* targetModel = NULL;
 	CFlags flagSuccess = CFALSE;
@@ -285,16 +505,20 @@ static void* modelTransfer(int32_t type, CamInt* cam)
 		case UNIVERSAL:
 		{
 			CLOG_I(2,"Converting to UNIVERSAL ... ...\n");
-			targetModel = new CamInt;
-			memcpy(targetModel,cam,sizeof(CamInt));
+			/* a deep copy, the target model owns its curves */
+			targetModel = new CamInt(*cam);
 			flagSuccess = CTRUE;
+			if (tolerance > 0.0F)
+			{
+				flagSuccess = resampleCurve((CamInt*)targetModel, tolerance);
+			}
 			break;
 		}
 		case KANNALA_BRANDT:
 		{
 			CLOG_I(2,"Converting to KANNALA_BRANDT ... ...\n");
 			targetModel = new CamIntKannalaBrandt;
-			flagSuccess = fitKannalaBrandt((CamIntKannalaBrandt*)targetModel, cam, 5);
+			flagSuccess = fitKannalaBrandt((CamIntKannalaBrandt*)targetModel, cam, kbOrder);
 			break;
 		}
 		default:CLOG_E("Unsupported camera model type!\n"); break;
@@ -302,23 +526,32 @@ static void* modelTransfer(int32_t type, CamInt* cam)
 	if (CFALSE == flagSuccess)
 	{
 		CLOG_I(0,"Could not complete the transform\n");
+		releaseModel(targetModel, type);
 		targetModel = NULL;
 	}
 	return targetModel;
 }
 
 /**
-* @brief save calculated model
-* @param path  [in] save path
-* @param model [in] calculated model
-* @param type  [in] target camera model type, align with [TargetCameraModel]
-* @return pointer to result
+* @brief save calculated model to _path_to_save_model
+* @param ctx [in] conversion context, with the calculated model
+* @return success flag
 */
-static void modelSave(const char* path, void*model, int32_t type)
+static CFlags modelSave(const ConversionContext* ctx)
 {
+	CFlags ret = CTRUE;
+	const char* path = ctx->cfg._path_to_save_model.c_str();
+	void* model = ctx->model;
+	int32_t type = ctx->mode;
 	if (NULL == model)
 	{
 		CLOG_I(0,"Model calculation error, exit\n");
+		ret = CFALSE;
+	}
+	else if ("BINARY" == ctx->cfg._save_format)
+	{
+		CLOG_I(1,"Saving to %s ... ...\n", path);
+		ret = saveModelFile(path, model, type);
 	}
 	else
 	{
@@ -328,6 +561,12 @@ static void modelSave(const char* path, void*model, int32_t type)
 		{
 			CLOG_I(1,"Saving to %s ... ...\n", path);
 			FILE* file2Save = fopen(path, "w+");
+			if (NULL == file2Save)
+			{
+				CLOG_E("Could not open %s to save\n", path);
+				ret = CFALSE;
+				break;
+			}
 			fprintf(file2Save, "# Following are all parameters required to describe a camera's intrinsic\n");
 			fprintf(file2Save, "# _TYPE             parameter type\n");
 			fprintf(file2Save, "# _W                image width, in pixel\n");
@@ -358,7 +597,10 @@ static void modelSave(const char* path, void*model, int32_t type)
 			fprintf(file2Save, "_DISORT = \n");
 			for (int32_t idx = 0; idx < ((CamInt*)model)->dCurveSize;idx++)
 			{
-				fprintf(file2Save, "%f %f\n", *(((CamInt*)model)->dCurve + idx * 2), *(((CamInt*)model)->dCurve + idx * 2+1));
+				/* the uniform grid in double, so a step of 0.1 prints as 8.400000, not 8.400001 */
+				const CamInt* cam = (CamInt*)model;
+				float64_t angle = cam->dAngle.empty() ? float64_t(idx)*cam->dStep : cam->dAngle[idx];
+				fprintf(file2Save, "%f %f\n", angle, cam->dRadius[idx]);
 			}
 			fclose(file2Save);
 			break;
@@ -367,6 +609,12 @@ static void modelSave(const char* path, void*model, int32_t type)
 		{
 			CLOG_I(1,"Saving to %s ... ...\n",path);
 			FILE* file2Save = fopen(path,"w+");
+			if (NULL == file2Save)
+			{
+				CLOG_E("Could not open %s to save\n", path);
+				ret = CFALSE;
+				break;
+			}
 			fprintf(file2Save, "# Following are all parameters required to describe a camera's intrinsic\n");
 			fprintf(file2Save, "# _TYPE             parameter type\n");
 			fprintf(file2Save, "# _W                image width, in pixel\n");
@@ -380,7 +628,8 @@ static void modelSave(const char* path, void*model, int32_t type)
 			fprintf(file2Save, "_H = %d\n", ((CamIntKannalaBrandt*)model)->imgHeight);
 			for (int32_t coefId = 0; coefId < ((CamIntKannalaBrandt*)model)->order; coefId++)
 			{
-				fprintf(file2Save, "_K%d = %f\n", coefId + 1, ((CamIntKannalaBrandt*)model)->k[coefId]);
+				/* every digit of the float, high order coef are far below 1e-6 */
+				fprintf(file2Save, "_K%d = %.9g\n", coefId + 1, ((CamIntKannalaBrandt*)model)->k[coefId]);
 			}
 			fprintf(file2Save, "_CU = %f\n", ((CamIntKannalaBrandt*)model)->cu);
 			fprintf(file2Save, "_CV = %f\n", ((CamIntKannalaBrandt*)model)->cv);
@@ -403,36 +652,423 @@ static void modelSave(const char* path, void*model, int32_t type)
 			fclose(file2Save);
 			break;
 		}
-		default:CLOG_E("Unsupported camera model type!\n"); break;
+		default:CLOG_E("Unsupported camera model type!\n"); ret = CFALSE; break;
+		}
+	}
+	return ret;
+}
+
+/**
+* @brief build and save remap maps between the transfered model and a
+*        virtual pinhole camera, see _remap_* config terms, saved to _remap_path
+* @param ctx [in] conversion context, with the calculated model
+* @return void return
+*/
+static void modelRemap(const ConversionContext* ctx)
+{
+	const CFG_CMT& cfg = ctx->cfg;
+	const char* path = cfg._remap_path.c_str();
+	void* model = ctx->model;
+	int32_t type = ctx->mode;
+	if (NULL == model)
+	{
+		CLOG_I(0,"Model calculation error, no remap maps\n");
+		return;
+	}
+	RemapDirection dir = FISHEYE_TO_PINHOLE;
+	if ("FISHEYE_TO_PINHOLE" == cfg._remap_type)
+	{
+		dir = FISHEYE_TO_PINHOLE;
+	}
+	else if ("PINHOLE_TO_FISHEYE" == cfg._remap_type)
+	{
+		dir = PINHOLE_TO_FISHEYE;
+	}
+	else
+	{
+		CLOG_E("Unsupport remap type %s\n", cfg._remap_type.c_str());
+		return;
+	}
+	PinholeInt pin;
+	if (CTRUE != setVirtualPinhole(&pin, model, type, cfg._remap_fov))
+	{
+		return;
+	}
+	if ("true" == cfg._remap_radial)
+	{
+		RemapRadial radial;
+		if (CTRUE == buildRemapRadial(&radial, model, type, &pin, dir))
+		{
+			CLOG_I(1,"Saving radial remap to %s ... ...\n", path);
+			saveRemapRadial(path, &radial);
 		}
+		releaseRemapRadial(&radial);
+		return;
 	}
+	ThreadPool pool(cfg._remap_threads);
+	RemapMap map;
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+	if (CTRUE == buildRemap(&map, model, type, &pin, dir, &pool))
+	{
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+		CLOG_I(2,"Remap maps %d x %d built in %.1f ms on %d threads\n", map.width, map.height, ms, pool.size());
+		CLOG_I(1,"Saving remap maps to %s ... ...\n", path);
+		saveRemap(path, &map);
+	}
+	releaseRemap(&map);
 	return;
 }
 
 /**
- * @brief show model disortion curves  
- * @param oriCam [in] original camera model
- * @param tgtCam [in] transfered camera model
+* @brief release a model returned by modelTransfer, a UNIVERSAL model
+*        is a deep copy and frees its own curves
+* @param model [in] calculated model
+* @param type  [in] target camera model type, align with [TargetCameraModel]
+* @return void return
+*/
+static void releaseModel(void* model, int32_t type)
+{
+	if (NULL == model)
+	{
+		return;
+	}
+	switch (type)
+	{
+	case UNIVERSAL: delete (CamInt*)model; break;
+	case KANNALA_BRANDT: delete (CamIntKannalaBrandt*)model; break;
+	default:CLOG_E("Unsupported camera model type!\n"); break;
+	}
+	return;
+}
+
+/**
+* @brief radius error of the transfered model against the original curve,
+*        at the angles the models are fitted on
+* @param oriCam   [in]  original camera model
+* @param model    [in]  calculated model
+* @param type     [in]  target camera model type, align with [TargetCameraModel]
+* @param rmsError [out] rms radius error, in mm
+* @param maxError [out] max radius error, in mm
+* @return success flag
+*/
+static CFlags modelFitError(CamInt* oriCam, void* model, int32_t type, float32_t* rmsError, float32_t* maxError)
+{
+	*rmsError = 0.0F;
+	*maxError = 0.0F;
+	if (oriCam->dCurveSize <= 0)
+	{
+		return CFALSE;
+	}
+	float64_t sum = 0.0;
+	float32_t maxErr = 0.0F;
+	if (UNIVERSAL == type)
+	{
+		/* findRfromA reads the spline of a long curve, so the error is up to the
+		   spline tolerance, see buildCurveSpline, unless the curve is resampled */
+		CamInt* cam = (CamInt*)model;
+		for (int32_t idx = 0; idx < oriCam->dCurveSize; idx++)
+		{
+			float32_t theta = float32_t(curveAngle(oriCam, idx)*DEG2RAD);
+			float32_t err = fabsf(findRfromA(theta, cam) - oriCam->dRadius[idx]);
+			sum += float64_t(err)*err;
+			maxErr = MAX(maxErr, err);
+		}
+		*rmsError = float32_t(sqrt(sum / oriCam->dCurveSize));
+		*maxError = maxErr;
+		return CTRUE;
+	}
+	if (KANNALA_BRANDT != type)
+	{
+		return CFALSE;
+	}
+	CFlags ret = dispatchKannalaBrandt((CamIntKannalaBrandt*)model, [&](const auto& kb)
+	{
+		for (int32_t idx = 0; idx < oriCam->dCurveSize; idx++)
+		{
+			float32_t theta = float32_t(curveAngle(oriCam, idx)*DEG2RAD);
+			float32_t err = fabsf(kb.radius(theta) - oriCam->dRadius[idx]);
+			sum += float64_t(err)*err;
+			maxErr = MAX(maxErr, err);
+		}
+	});
+	*rmsError = float32_t(sqrt(sum / oriCam->dCurveSize));
+	*maxError = maxErr;
+	return ret;
+}
+
+/**
+* @brief list the models of a batch, _batch_input is either a directory,
+*        every regular file in it is a model, or a manifest, one model
+*        path per line, relative paths start at the manifest's directory
+* @param input  [in]  directory or manifest
+* @param models [out] model paths, sorted for a directory
+* @return success flag
+*/
+static bool listBatchModels(const string& input, vector<string>& models)
+{
+	namespace fs = std::filesystem;
+	std::error_code ec;
+	models.clear();
+	if (fs::is_directory(input, ec))
+	{
+		fs::directory_iterator end;
+		for (fs::directory_iterator it(input, ec); !ec && (it != end); it.increment(ec))
+		{
+			/* hidden files are not models */
+			string name = it->path().filename().string();
+			if (('.' != name[0]) && it->is_regular_file(ec))
+			{
+				models.push_back(it->path().string());
+			}
+		}
+		if (ec)
+		{
+			CLOG_E("Could not list models in %s\n", input.c_str());
+			return false;
+		}
+		std::sort(models.begin(), models.end());
+		return true;
+	}
+
+	std::ifstream manifest(input);
+	if (!manifest.is_open())
+	{
+		CLOG_E("Could not open batch input %s\n", input.c_str());
+		return false;
+	}
+	fs::path base = fs::path(input).parent_path();
+	string line;
+	while (std::getline(manifest, line))
+	{
+		/* one path per line, blank lines and # comments are skipped */
+		size_t begin = line.find_first_not_of(" \t\r");
+		if ((string::npos == begin) || ('#' == line[begin]))
+		{
+			continue;
+		}
+		size_t last = line.find_last_not_of(" \t\r");
+		fs::path model = line.substr(begin, last - begin + 1);
+		if (model.is_relative())
+		{
+			model = base / model;
+		}
+		models.push_back(model.string());
+	}
+	return true;
+}
+
+/**
+* @brief load, transfer and save one model of a batch
+* @param batch  [in]     batch context, config and target type are read
+* @param result [in/out] inPath and outPath are read, the rest is filled
+* @return void return
+*/
+static void convertModel(const ConversionContext* batch, BatchResult* result)
+{
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+	result->status = CFALSE;
+	result->rmsError = 0.0F;
+	result->maxError = 0.0F;
+	/* one context per model, it owns the models and releases them */
+	ConversionContext ctx;
+	ctx.cfg = batch->cfg;
+	ctx.cfg._path_to_ori_model = result->inPath;
+	ctx.cfg._path_to_save_model = result->outPath;
+	ctx.mode = batch->mode;
+	ctx.oriCam = loadCamInts(ctx.cfg._path_to_ori_model.c_str());
+	if (ctx.oriCam.dRadius.empty())
+	{
+		result->message = "could not load the model";
+	}
+	else
+	{
+		ctx.model = modelTransfer(ctx.mode, &ctx.oriCam, ctx.cfg._curve_tolerance, ctx.cfg._kb_order);
+		if (NULL == ctx.model)
+		{
+			result->message = "could not complete the transform";
+		}
+		else if (CTRUE != modelFitError(&ctx.oriCam, ctx.model, ctx.mode, &result->rmsError, &result->maxError))
+		{
+			result->message = "could not evaluate the transfered model";
+		}
+		else if (CTRUE != modelSave(&ctx))
+		{
+			result->message = "could not save the model";
+		}
+		else
+		{
+			result->status = CTRUE;
+		}
+	}
+	result->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+	return;
+}
+
+/**
+* @brief convert every model of _batch_input on a thread pool, save them
+*        in _batch_output and write the summary to _batch_report
+* @param batch [in] batch context, config and target type are read
+* @return number of models failed, -1 if the batch could not run or the
+*         report could not be saved
+*/
+static int32_t modelBatch(const ConversionContext* batch)
+{
+	const CFG_CMT& cfg = batch->cfg;
+	namespace fs = std::filesystem;
+	vector<string> models;
+	if (false == listBatchModels(cfg._batch_input, models))
+	{
+		return -1;
+	}
+	if (models.empty())
+	{
+		CLOG_E("No model found in %s\n", cfg._batch_input.c_str());
+		return -1;
+	}
+	std::error_code ec;
+	fs::create_directories(cfg._batch_output, ec);
+	if (ec)
+	{
+		CLOG_E("Could not create batch output %s\n", cfg._batch_output.c_str());
+		return -1;
+	}
+
+	/* saved models keep the single model naming, [model]_[target type],
+	   models of the same name from different directories get an index,
+	   [model]_[index]_[target type], so no worker overwrites another */
+	vector<BatchResult> results(models.size());
+	std::set<string> names;
+	for (size_t idx = 0; idx < models.size(); idx++)
+	{
+		results[idx].inPath = models[idx];
+		string name = fs::path(models[idx]).filename().string();
+		string unique = name;
+		for (int32_t count = 2; !names.insert(unique).second; count++)
+		{
+			unique = name + "_" + std::to_string(count);
+		}
+		if (unique != name)
+		{
+			CLOG_I(1,"%s is saved as %s, the name is taken by another model\n", models[idx].c_str(), unique.c_str());
+		}
+		results[idx].outPath = (fs::path(cfg._batch_output) / (unique + "_" + cfg._target_model_type)).string();
+	}
+
+	/* models are handed out one by one, a large curve does not hold up the others */
+	ThreadPool pool(cfg._batch_threads);
+	CLOG_I(1,"Converting %d models on %d threads ... ...\n", int32_t(results.size()), pool.size());
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+	pool.parallelFor(int32_t(results.size()), [&](int32_t idx)
+	{
+		convertModel(batch, &results[idx]);
+	});
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+	int32_t failed = 0;
+	for (size_t idx = 0; idx < results.size(); idx++)
+	{
+		if (CTRUE != results[idx].status)
+		{
+			CLOG_E("%s: %s\n", results[idx].inPath.c_str(), results[idx].message.c_str());
+			failed++;
+		}
+	}
+	CLOG_I(1,"%d of %d models converted in %.1f ms\n", int32_t(results.size()) - failed, int32_t(results.size()), ms);
+	CLOG_I(1,"Saving batch report to %s ... ...\n", cfg._batch_report.c_str());
+	if (false == saveBatchReport(batch, results, ms, pool.size()))
+	{
+		return -1;
+	}
+	return failed;
+}
+
+/**
+* @brief save the summary of a batch to _batch_report, one line per model
+* @param batch   [in] batch context, config is read
+* @param results [in] results of all models, in input order
+* @param ms      [in] time spent on the whole batch
+* @param threads [in] number of threads converting models
+* @return success flag
+*/
+static bool saveBatchReport(const ConversionContext* batch, const vector<BatchResult>& results, double ms, int32_t threads)
+{
+	const CFG_CMT& cfg = batch->cfg;
+	const char* path = cfg._batch_report.c_str();
+	FILE* file2Save = fopen(path, "w+");
+	if (NULL == file2Save)
+	{
+		CLOG_E("Could not open %s to save\n", path);
+		return false;
+	}
+	int32_t failed = 0;
+	for (size_t idx = 0; idx < results.size(); idx++)
+	{
+		failed += (CTRUE != results[idx].status) ? 1 : 0;
+	}
+	fprintf(file2Save, "# Batch conversion summary\n");
+	fprintf(file2Save, "# _batch_input        %s\n", cfg._batch_input.c_str());
+	fprintf(file2Save, "# _target_model_type  %s\n", cfg._target_model_type.c_str());
+	fprintf(file2Save, "# models              %d, converted %d, failed %d\n", int32_t(results.size()), int32_t(results.size()) - failed, failed);
+	fprintf(file2Save, "# time                %.1f ms on %d threads\n", ms, threads);
+	fprintf(file2Save, "# one model per line, tab separated:\n");
+	fprintf(file2Save, "# status, rms radius error in mm, max radius error in mm, time in ms, model, saved model or failure\n");
+	for (size_t idx = 0; idx < results.size(); idx++)
+	{
+		const BatchResult& result = results[idx];
+		if (CTRUE == result.status)
+		{
+			fprintf(file2Save, "OK\t%g\t%g\t%.1f\t%s\t%s\n", result.rmsError, result.maxError, result.ms,
+				result.inPath.c_str(), result.outPath.c_str());
+		}
+		else
+		{
+			fprintf(file2Save, "FAIL\t-\t-\t%.1f\t%s\t%s\n", result.ms, result.inPath.c_str(), result.message.c_str());
+		}
+	}
+	fclose(file2Save);
+	return true;
+}
+
+/**
+ * @brief show model disortion curves, the plot is saved to _show_offset_path
+ * @param ctx [in] conversion context, with the original and the calculated model
  * @return void return
  */
-static void modelShow(CamInt* oriCam, void* tgtCam)
+static void modelShow(const ConversionContext* ctx)
 {
-	CamInt* tgtCamT = new CamInt;
-	if("UNIVERSAL" == gCFG._target_model_type)
+	const CamInt* oriCam = &ctx->oriCam;
+	void* tgtCam = ctx->model;
+	CamInt tgtCamKB;				/* curve of a KANNALA_BRANDT model */
+	CamInt* tgtCamT = NULL;
+	if (NULL == tgtCam)
+	{
+		CLOG_I(0,"Model calculation error, no disortion curve plot\n");
+		return;
+	}
+	if(UNIVERSAL == ctx->mode)
 	{
-		memcpy(tgtCamT,tgtCam,sizeof(CamInt));
+		tgtCamT = (CamInt*)tgtCam;
 	}
-	else if("KANNALA_BRANDT" == gCFG._target_model_type)
+	else if(KANNALA_BRANDT == ctx->mode)
 	{
-		extractKannalaBrandt(tgtCamT, (CamIntKannalaBrandt*)tgtCam);
+		if (CTRUE == extractKannalaBrandt(&tgtCamKB, (CamIntKannalaBrandt*)tgtCam))
+		{
+			tgtCamT = &tgtCamKB;
+		}
 	}
 	else
 	{
 		CLOG_E("Unsupport camere model type\n");
 	}
+	if (NULL == tgtCamT)
+	{
+		return;
+	}
+	/* the target is evaluated at the angles of the original, its knots may be elsewhere */
+	int32_t curveSize = oriCam->dCurveSize;
 	float step = 0.002;
-	float maxR = MAX(*(oriCam->dCurve+2*(oriCam->dCurveSize-1)+1), 
-	                 *(tgtCamT->dCurve+2*(tgtCamT->dCurveSize-1)+1));
+	float maxR = MAX(oriCam->dRadius[oriCam->dCurveSize-1], 
+	                 tgtCamT->dRadius[tgtCamT->dCurveSize-1]);
 	int yMax = int(maxR/step + 1);
 	float boundaryRate = 1.05;
 	CvSize sz = {oriCam->dCurveSize*boundaryRate,yMax*boundaryRate};
@@ -443,12 +1079,12 @@ static void modelShow(CamInt* oriCam, void* tgtCam)
 	cvLine(pImg,cvPoint(0,yMax),cvPoint(sz.width,yMax),cvScalar(0,0,0));
 	cvLine(pImg,cvPoint(wOffset,0),cvPoint(wOffset,sz.height),cvScalar(0,0,0));
 	float32_t error = 0.0;
-	for(int idx = 1; idx < oriCam->dCurveSize;idx++)
+	float _r2 = findRfromA(float32_t(curveAngle(oriCam, 0)*DEG2RAD), tgtCamT);
+	for(int idx = 1; idx < curveSize;idx++)
 	{
-		float r1 = *(oriCam->dCurve+2*idx+1);
-		float _r1 = *(oriCam->dCurve+2*(idx-1)+1);
-		float r2 = *(tgtCamT->dCurve+2*idx+1);
-		float _r2 = *(tgtCamT->dCurve+2*(idx-1)+1);
+		float r1 = oriCam->dRadius[idx];
+		float _r1 = oriCam->dRadius[idx-1];
+		float r2 = findRfromA(float32_t(curveAngle(oriCam, idx)*DEG2RAD), tgtCamT);
 		error += (r1-r2)*(r1-r2);
 		CvPoint pt1 = {idx+wOffset,yMax - int(r1/step)};
 		CvPoint _pt1 = {idx-1+wOffset,yMax - int(_r1/step)};
@@ -456,6 +1092,7 @@ static void modelShow(CamInt* oriCam, void* tgtCam)
 		CvPoint _pt2 = {idx-1+wOffset,yMax - int(_r2/step)};
 		cvLine(pImg,_pt1,pt1,cvScalar(255,0,0));
 		cvLine(pImg,_pt2,pt2,cvScalar(0,0,255));
+		_r2 = r2;
 	}
 	float32_t finalError = sqrtf(error)/oriCam->dCurveSize;
 	CLOG_I(1,"The disortion curve offset error is %f\n",finalError);
@@ -463,9 +1100,8 @@ static void modelShow(CamInt* oriCam, void* tgtCam)
 	// cvShowImage("Disortion Curve",pImg);
 	
 	int params[2]={CV_IMWRITE_JPEG_QUALITY , 100}; 
-	cvSaveImage(gCFG._show_offset_path.c_str(),pImg,params);
+	cvSaveImage(ctx->cfg._show_offset_path.c_str(),pImg,params);
 	cvReleaseImage(&pImg);
-	CLOG_I(1,"Disortion curve offset plot is save as %s\n",gCFG._show_offset_path.c_str());
-	delete tgtCamT->dCurve,tgtCamT;
+	CLOG_I(1,"Disortion curve offset plot is save as %s\n",ctx->cfg._show_offset_path.c_str());
 	return;
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: owning float buffer for camera model curves, the memory
+*              comes from a size-class pool shared by all threads, so
+*              converting model after model reuses the same buffers
+*/
+#include "CurveBuffer.h"
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#define CURVE_POOL_MIN_SHIFT	(6)				/* smallest size class, 64 elements */
+#define CURVE_POOL_MAX_SHIFT	(24)			/* largest size class, larger buffers are not pooled */
+#define CURVE_POOL_MAX_FREE		(16)			/* free buffers kept per size class */
+#define CURVE_POOL_MAX_BYTES	(size_t(64) << 20)	/* free bytes kept in all size classes */
+
+/**
+* free buffers of every size class, a size class holds 2^shift elements
+*/
+struct CurvePool
+{
+	CurvePool() : freeBytes(0) {}
+	std::mutex			mutex;
+	std::vector<float*>	freeList[CURVE_POOL_MAX_SHIFT - CURVE_POOL_MIN_SHIFT + 1];
+	size_t				freeBytes;
+};
+
+/* never destroyed, curves may still be released while statics are destroyed */
+static CurvePool& curvePool()
+{
+	static CurvePool* pool = new CurvePool;
+	return *pool;
+}
+
+static int sizeClass(size_t n)
+{
+	int shift = CURVE_POOL_MIN_SHIFT;
+	while ((shift <= CURVE_POOL_MAX_SHIFT) && ((size_t(1) << shift) < n))
+	{
+		shift++;
+	}
+	return shift;
+}
+
+/**
+* @brief take a buffer of at least n elements from the pool
+* @param n        [in]  number of elements, larger than 0
+* @param capacity [out] number of elements allocated
+* @return buffer
+*/
+static float* poolAcquire(size_t n, size_t* capacity)
+{
+	int shift = sizeClass(n);
+	if (shift > CURVE_POOL_MAX_SHIFT)
+	{
+		*capacity = n;
+		return new float[n];
+	}
+	*capacity = size_t(1) << shift;
+	CurvePool& pool = curvePool();
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		std::vector<float*>& freeList = pool.freeList[shift - CURVE_POOL_MIN_SHIFT];
+		if (!freeList.empty())
+		{
+			float* p = freeList.back();
+			freeList.pop_back();
+			pool.freeBytes -= *capacity * sizeof(float);
+			return p;
+		}
+	}
+	return new float[*capacity];
+}
+
+/**
+* @brief give a buffer back to the pool, it is freed when the pool is full
+* @param p        [in] buffer from poolAcquire
+* @param capacity [in] number of elements allocated
+* @return void return
+*/
+static void poolRelease(float* p, size_t capacity)
+{
+	if (NULL == p)
+	{
+		return;
+	}
+	int shift = sizeClass(capacity);
+	if ((shift <= CURVE_POOL_MAX_SHIFT) && (capacity == (size_t(1) << shift)))
+	{
+		size_t bytes = capacity * sizeof(float);
+		CurvePool& pool = curvePool();
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		std::vector<float*>& freeList = pool.freeList[shift - CURVE_POOL_MIN_SHIFT];
+		if ((freeList.size() < CURVE_POOL_MAX_FREE) && (pool.freeBytes + bytes <= CURVE_POOL_MAX_BYTES))
+		{
+			freeList.push_back(p);
+			pool.freeBytes += bytes;
+			return;
+		}
+	}
+	delete[] p;
+	return;
+}
+
+CurveBuffer::CurveBuffer(const CurveBuffer& b)
+	: ptr(NULL), count(0), capacity(0)
+{
+	allocate(b.count);
+	if (0 < count)
+	{
+		memcpy(ptr, b.ptr, count * sizeof(float));
+	}
+}
+
+CurveBuffer& CurveBuffer::operator=(const CurveBuffer& b)
+{
+	if (this != &b)
+	{
+		allocate(b.count);
+		if (0 < count)
+		{
+			memcpy(ptr, b.ptr, count * sizeof(float));
+		}
+	}
+	return *this;
+}
+
+CurveBuffer::CurveBuffer(CurveBuffer&& b) noexcept
+	: ptr(b.ptr), count(b.count), capacity(b.capacity)
+{
+	b.ptr = NULL;
+	b.count = 0;
+	b.capacity = 0;
+}
+
+CurveBuffer& CurveBuffer::operator=(CurveBuffer&& b) noexcept
+{
+	if (this != &b)
+	{
+		reset();
+		ptr = b.ptr;
+		count = b.count;
+		capacity = b.capacity;
+		b.ptr = NULL;
+		b.count = 0;
+		b.capacity = 0;
+	}
+	return *this;
+}
+
+/**
+* Hold n elements, contents are undefined, the current buffer is
+* kept when it is large enough
+* @param n [in] number of elements
+* @return void return
+*/
+void CurveBuffer::allocate(size_t n)
+{
+	if ((NULL != ptr) && (n <= capacity))
+	{
+		count = n;
+		return;
+	}
+	reset();
+	if (0 < n)
+	{
+		ptr = poolAcquire(n, &capacity);
+		count = n;
+	}
+	return;
+}
+
+/**
+* Return the buffer to the pool, empty() afterwards
+* @return void return
+*/
+void CurveBuffer::reset()
+{
+	poolRelease(ptr, capacity);
+	ptr = NULL;
+	count = 0;
+	capacity = 0;
+	return;
+}
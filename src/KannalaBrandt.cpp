@@ -6,6 +6,29 @@
 * Description: fit camera model KannalaBrandt
 */
 #include "KannalaBrandt.h"
+#include "simd.h"
+
+/**
+* @brief sample a curve on a uniform angle grid, from 0 to its last angle,
+*        for fits that weigh every angle the same
+* @param uniform [out] uniform curve, only dStep, dCurveSize and dRadius are set
+* @param cam     [in]  camera model, usually with a non-uniform curve
+* @param size    [in]  number of points
+* @return void return
+*/
+static void sampleUniformCurve(CamInt* uniform, CamInt* cam, int32_t size)
+{
+	uniform->dCurveSize = size;
+	uniform->dStep = curveAngle(cam, cam->dCurveSize - 1) / (size - 1);
+	uniform->dAngle.reset();
+	uniform->dRadius.allocate(size);
+	for (int32_t idx = 0; idx < size; idx++)
+	{
+		uniform->dRadius[idx] = findRfromA(float32_t(idx*uniform->dStep*DEG2RAD), cam);
+	}
+	return;
+}
+
 /**
 * @brief fit KannalaBrandt model
 * r = k1 * theta + k2 * theta^3 + k3 * theta^5 + ... + ki * theta^(2*i-1)
@@ -19,7 +42,8 @@
 CFlags fitKannalaBrandt(CamIntKannalaBrandt* targetModel, CamInt* cam, int32_t order)
 {
 	CFlags ret = CTRUE;
-	memset(targetModel, 0, sizeof(CamIntKannalaBrandt));
+	/* every field is set below, k keeps its capacity so refits do not allocate */
+	targetModel->k.clear();
 
 	targetModel->order = order;
 
@@ -34,18 +58,35 @@ CFlags fitKannalaBrandt(CamIntKannalaBrandt* targetModel, CamInt* cam, int32_t o
 	targetModel->mu = targetModel->cu / ru;
 	targetModel->mv = targetModel->cv / rv;
 
-	std::vector<float32_t> thetaPow = thetaPowerSum(cam, order);
-	std::vector<float32_t> radiusThetaPow = radiusThetaPowerSum(cam, order);
-	Matrix A = constructMatrixA(thetaPow);
-	Matrix B = constructMatrixB(radiusThetaPow, thetaPow);
-	Matrix A_inv = inverse(A);
-	Matrix K = A_inv*B;
-	targetModel->k.push_back(1);
-	for (int32_t kIdx = 0; kIdx < order - 1; kIdx++)
+	/* knots of a non-uniform curve are dense where it bends, fit on a uniform grid so every angle weighs the same */
+	CamInt uniformCam;
+	if (!cam->dAngle.empty())
 	{
-		targetModel->k.push_back(float32_t(K[kIdx][0]));
+		sampleUniformCurve(&uniformCam, cam, DEFAULT_CURVE_SIZE);
+		cam = &uniformCam;
 	}
-	return ret;
+
+	/* the normal equations are order - 1 square, sized at compile time and kept on the stack */
+	CFlags dispatched = dispatchKannalaBrandtOrder(order, [&](auto fixedOrder)
+	{
+		constexpr int32_t Order = decltype(fixedOrder)::value;
+		targetModel->k.push_back(1);
+		if constexpr (Order > 1)
+		{
+			SMatrix<Order - 1, 1> K;
+			if (CTRUE != lsqKannalaBrandt<Order>(cam, K))
+			{
+				CLOG_E("KannalaBrandt fit is singular, order %d\n", order);
+				ret = CFALSE;
+				return;
+			}
+			for (int32_t kIdx = 0; kIdx < Order - 1; kIdx++)
+			{
+				targetModel->k.push_back(float32_t(K[kIdx][0]));
+			}
+		}
+	});
+	return (CTRUE == dispatched) ? ret : CFALSE;
 }
 
 /**
@@ -70,18 +111,22 @@ CFlags extractKannalaBrandt(CamInt* cam, CamIntKannalaBrandt* targetModel)
 	cam->cv = targetModel->cv;
 	cam->dCurveSize = DEFAULT_CURVE_SIZE;
 	cam->dStep = DEFAULT_CURVE_STEP;
-	cam->dCurve = new float[2 * DEFAULT_CURVE_SIZE];
-	for (int32_t idx = 0; idx < cam->dCurveSize;idx++)
-	{
-		*(cam->dCurve + 2 * idx) = 0;
-		*(cam->dCurve + 2 * idx) = idx*cam->dStep;
-		float32_t theta = idx*cam->dStep*DEG2RAD;
-		*(cam->dCurve + 2 * idx + 1) = 0.0F;
-		for (int32_t kIdx = 0; kIdx < targetModel->k.size();kIdx++)
+	cam->dRadius.allocate(DEFAULT_CURVE_SIZE);
+	cam->dAngle.reset();
+	CFlags orderOk = dispatchKannalaBrandt(targetModel, [&](const auto& model)
+	{
+		for (int32_t idx = 0; idx < cam->dCurveSize; idx++)
 		{
-			*(cam->dCurve + 2 * idx + 1) += targetModel->k[kIdx] * pow(theta, 2 * kIdx + 1);
+			float32_t theta = idx*cam->dStep*DEG2RAD;
+			cam->dRadius[idx] = model.radius(theta);
 		}
+	});
+	if (CTRUE != orderOk)
+	{
+		cam->dRadius.reset();
+		return CFALSE;
 	}
+	buildRadiusLut(cam);
 	float32_t ru = targetModel->cu / targetModel->mu;
 	float32_t rv = targetModel->cv / targetModel->mv;
 	cam->fu = findAfromR(ru, cam);
@@ -90,120 +135,311 @@ CFlags extractKannalaBrandt(CamInt* cam, CamIntKannalaBrandt* targetModel)
 }
 
 /**
-* @brief calculate theta's power sum.
-*        this is for fitKannalaBrandt, during the lsq process
-* @param cam   [in] cam model
-* @param order [in] order of kannala brandt model
-* @return vector contains power sum from order 6 to 4m+2, where m is kannala brandt order
+* @brief KannalaBrandt model broadcast to SIMD vectors
 */
-static std::vector<float32_t> thetaPowerSum(CamInt* cam, int32_t order)
+template <int32_t Order>
+struct KannalaBrandtVec
 {
-	std::vector<float32_t> ret;
-	float32_t* theta = new float32_t[cam->dCurveSize];
-	for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize; thetaIdx++)
+	vf32 k[Order];				/* coef, k1 ... ki */
+	vf32 dk[Order];				/* derivative coef, (2*i-1) * ki */
+	vf32 cu, cv, mu, mv;
+
+	explicit KannalaBrandtVec(const KannalaBrandt<Order>& model)
 	{
-		*(theta + thetaIdx) = float32_t((thetaIdx)*cam->dStep*DEG2RAD);
+		for (int32_t kIdx = 0; kIdx < Order; kIdx++)
+		{
+			k[kIdx] = vSet1(model.k[kIdx]);
+			dk[kIdx] = vSet1(model.k[kIdx] * float32_t(2 * kIdx + 1));
+		}
+		cu = vSet1(model.cu);
+		cv = vSet1(model.cv);
+		mu = vSet1(model.mu);
+		mv = vSet1(model.mv);
 	}
-	float32_t* thetaBuffer = new float32_t[cam->dCurveSize];
-	memcpy(thetaBuffer, theta, sizeof(float32_t)*cam->dCurveSize);
-	for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize; thetaIdx++)
+};
+
+/**
+* @brief c[0] + c[1] * t + ... + c[Order-1] * t^(Order-1) per lane, unrolled at compile time
+*/
+template <int32_t Order, int32_t Idx = 0>
+static inline vf32 vPoly(const vf32* c, vf32 t)
+{
+	if constexpr (Idx == Order - 1)
 	{
-		*(thetaBuffer + thetaIdx) *= *(theta + thetaIdx);/* theta power of 2 */
+		return c[Idx];
 	}
+	else
+	{
+		return vFmadd(vPoly<Order, Idx + 1>(c, t), t, c[Idx]);
+	}
+}
+
+/**
+* @brief project one SIMD vector of points, see projectKannalaBrandt
+*/
+template <int32_t Order>
+static inline void projectKernel(const KannalaBrandtVec<Order>& vm, vf32 x, vf32 y, vf32 z, vf32* u, vf32* v)
+{
+	vf32 rxy = vSqrt(vFmadd(x, x, vMul(y, y)));
+	vf32 theta = vAtan2Pos(rxy, z);
+	vf32 r = vMul(vPoly<Order>(vm.k, vMul(theta, theta)), theta);
+	/* points on the optic axis land on the optic center */
+	vm32 offAxis = vCmpGt(rxy, vSet1(1e-30F));
+	vf32 scale = vSelect(offAxis, vDiv(r, vMax(rxy, vSet1(1e-30F))), vSet1(0.0F));
+	*u = vFmadd(vMul(vm.mu, scale), x, vm.cu);
+	*v = vFmadd(vMul(vm.mv, scale), y, vm.cv);
+	return;
+}
 
-	int32_t st = 3;
-	int32_t ed = 4 * (order)+2;
-	for (int32_t idx = st; idx < ed + 1; idx++)
+/**
+* @brief unproject one SIMD vector of pixels, see unprojectKannalaBrandt
+*/
+template <int32_t Order>
+static inline void unprojectKernel(const KannalaBrandtVec<Order>& vm, vf32 u, vf32 v, vf32* x, vf32* y, vf32* z)
+{
+	vf32 mx = vDiv(vSub(u, vm.cu), vm.mu);
+	vf32 my = vDiv(vSub(v, vm.cv), vm.mv);
+	vf32 r = vSqrt(vFmadd(mx, mx, vMul(my, my)));
+	/* k1 is fixed to 1, so theta = r is a good initial guess */
+	vf32 theta = r;
+	for (int32_t iter = 0; iter < KB_NEWTON_ITER; iter++)
 	{
-		float32_t summ = 0.0F;
-		for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize; thetaIdx++)
+		vf32 theta2 = vMul(theta, theta);
+		vf32 err = vFmadd(vPoly<Order>(vm.k, theta2), theta, vSub(vSet1(0.0F), r));
+		if (vmAll(vCmpLt(vAbs(err), vSet1(1e-7F))))
 		{
-			*(thetaBuffer + thetaIdx) *= *(theta + thetaIdx);/* power increase by 1 */
-			summ += *(thetaBuffer + thetaIdx);
+			break;
 		}
-		ret.push_back(summ);
+		vf32 dpoly = vMax(vPoly<Order>(vm.dk, theta2), vSet1(1e-6F));
+		theta = vSub(theta, vDiv(err, dpoly));
+		theta = vMin(vMax(theta, vSet1(0.0F)), vSet1(float32_t(PI)));
 	}
-	delete thetaBuffer, theta;
-	return ret;
+	vf32 sinT, cosT;
+	vSinCosPos(theta, &sinT, &cosT);
+	/* pixels on the optic center look along the optic axis */
+	vm32 offAxis = vCmpGt(r, vSet1(1e-30F));
+	vf32 scale = vSelect(offAxis, vDiv(sinT, vMax(r, vSet1(1e-30F))), vSet1(0.0F));
+	*x = vMul(scale, mx);
+	*y = vMul(scale, my);
+	*z = vSelect(offAxis, cosT, vSet1(1.0F));
+	return;
 }
 
 /**
-* @brief calculate radius*theta's power sum.
-*        this is for fitKannalaBrandt, during the lsq process
-* @param cam   [in] cam model
-* @param order [in] order of kannala brandt model
-* @return vector contains power sum from order 3 to 2m+1, where m is kannala brandt order
+* @brief project points with a compile time order, see projectKannalaBrandt
 */
-static std::vector<float32_t> radiusThetaPowerSum(CamInt* cam, int32_t order)
+template <int32_t Order>
+static void projectBatch(const KannalaBrandt<Order>& model, const float32_t* x, const float32_t* y, const float32_t* z,
+	float32_t* u, float32_t* v, int32_t n)
 {
-	std::vector<float32_t> ret;
-	float32_t* radius = new float32_t[cam->dCurveSize];
-	for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize;thetaIdx++)
+	KannalaBrandtVec<Order> vm(model);
+	int32_t idx = 0;
+	for (; idx + SIMD_WIDTH <= n; idx += SIMD_WIDTH)
 	{
-		*(radius + thetaIdx) = *(cam->dCurve + thetaIdx*2 +1);
+		vf32 vu, vv;
+		projectKernel(vm, vLoad(x + idx), vLoad(y + idx), vLoad(z + idx), &vu, &vv);
+		vStore(u + idx, vu);
+		vStore(v + idx, vv);
 	}
-	float32_t* theta = new float32_t[cam->dCurveSize];
-	for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize; thetaIdx++)
-	{
-		*(theta + thetaIdx) = float32_t((thetaIdx)*cam->dStep *DEG2RAD);/* radius*theta power of 2 */
+	if (idx < n)
+	{/* tail, run one padded vector */
+		float32_t bx[SIMD_WIDTH] = { 0 }, by[SIMD_WIDTH] = { 0 }, bz[SIMD_WIDTH] = { 0 };
+		float32_t bu[SIMD_WIDTH], bv[SIMD_WIDTH];
+		int32_t nTail = n - idx;
+		memcpy(bx, x + idx, sizeof(float32_t)*nTail);
+		memcpy(by, y + idx, sizeof(float32_t)*nTail);
+		memcpy(bz, z + idx, sizeof(float32_t)*nTail);
+		vf32 vu, vv;
+		projectKernel(vm, vLoad(bx), vLoad(by), vLoad(bz), &vu, &vv);
+		vStore(bu, vu);
+		vStore(bv, vv);
+		memcpy(u + idx, bu, sizeof(float32_t)*nTail);
+		memcpy(v + idx, bv, sizeof(float32_t)*nTail);
 	}
-	float32_t* thetaBuffer = new float32_t[cam->dCurveSize];
-	memcpy(thetaBuffer, theta, sizeof(float32_t)*cam->dCurveSize);
-	for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize; thetaIdx++)
+	return;
+}
+
+/**
+* @brief unproject pixels with a compile time order, see unprojectKannalaBrandt
+*/
+template <int32_t Order>
+static void unprojectBatch(const KannalaBrandt<Order>& model, const float32_t* u, const float32_t* v,
+	float32_t* x, float32_t* y, float32_t* z, int32_t n)
+{
+	KannalaBrandtVec<Order> vm(model);
+	int32_t idx = 0;
+	for (; idx + SIMD_WIDTH <= n; idx += SIMD_WIDTH)
 	{
-		*(thetaBuffer + thetaIdx) *= (*(radius + thetaIdx))*(*(theta + thetaIdx));/* radius*theta power of 2 */
+		vf32 vx, vy, vz;
+		unprojectKernel(vm, vLoad(u + idx), vLoad(v + idx), &vx, &vy, &vz);
+		vStore(x + idx, vx);
+		vStore(y + idx, vy);
+		vStore(z + idx, vz);
+	}
+	if (idx < n)
+	{/* tail, run one padded vector */
+		float32_t bu[SIMD_WIDTH] = { 0 }, bv[SIMD_WIDTH] = { 0 };
+		float32_t bx[SIMD_WIDTH], by[SIMD_WIDTH], bz[SIMD_WIDTH];
+		int32_t nTail = n - idx;
+		memcpy(bu, u + idx, sizeof(float32_t)*nTail);
+		memcpy(bv, v + idx, sizeof(float32_t)*nTail);
+		vf32 vx, vy, vz;
+		unprojectKernel(vm, vLoad(bu), vLoad(bv), &vx, &vy, &vz);
+		vStore(bx, vx);
+		vStore(by, vy);
+		vStore(bz, vz);
+		memcpy(x + idx, bx, sizeof(float32_t)*nTail);
+		memcpy(y + idx, by, sizeof(float32_t)*nTail);
+		memcpy(z + idx, bz, sizeof(float32_t)*nTail);
 	}
+	return;
+}
 
-	int32_t st = 3;
-	int32_t ed = 2 * (order)+1;
-	for (int32_t idx = st; idx < ed + 1; idx++)
+/**
+* @brief project 3D points to pixels with KannalaBrandt model, in batch
+* @param model [in]  model parameters
+* @param x     [in]  point x
+* @param y     [in]  point y
+* @param z     [in]  point z, optic axis
+* @param u     [out] pixel u
+* @param v     [out] pixel v
+* @param n     [in]  number of points
+* @return success flag
+*/
+CFlags projectKannalaBrandt(CamIntKannalaBrandt* model, const float32_t* x, const float32_t* y, const float32_t* z,
+	float32_t* u, float32_t* v, int32_t n)
+{
+	return dispatchKannalaBrandt(model, [&](const auto& fixed)
 	{
-		float32_t summ = 0.0F;
-		for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize; thetaIdx++)
-		{
-			*(thetaBuffer + thetaIdx) *= *(theta + thetaIdx);/* power increase by 1 */
-			summ += *(thetaBuffer + thetaIdx);
-		}
-		ret.push_back(summ);
-	}
-	delete thetaBuffer, theta, radius;
-	return ret;
+		projectBatch(fixed, x, y, z, u, v, n);
+	});
 }
 
 /**
-* @brief Construct matrix A to solve AK=B, for fitKannalaBrandt
-* @param thetaPower [in] calculated theta power from 3 to 4m+2, where m is kannala brandt order
-* @return calculated matrix A
+* @brief unproject pixels to unit bearing vectors with KannalaBrandt model, in batch
+* @param model [in]  model parameters
+* @param u     [in]  pixel u
+* @param v     [in]  pixel v
+* @param x     [out] bearing x
+* @param y     [out] bearing y
+* @param z     [out] bearing z, optic axis
+* @param n     [in]  number of pixels
+* @return success flag
 */
-static Matrix constructMatrixA(std::vector<float32_t> thetaPower)
+CFlags unprojectKannalaBrandt(CamIntKannalaBrandt* model, const float32_t* u, const float32_t* v,
+	float32_t* x, float32_t* y, float32_t* z, int32_t n)
 {
-	int32_t nRowCol = int32_t(thetaPower.size() / 4) - 1;
-	Matrix A = zeros(nRowCol, nRowCol);
-	for (int32_t rowIdx = 0; rowIdx < nRowCol; rowIdx++)
+	return dispatchKannalaBrandt(model, [&](const auto& fixed)
 	{
-		for (int32_t colIdx = 0; colIdx < nRowCol; colIdx++)
-		{
-			int32_t pw = 2 * (rowIdx + 1) + 1 + 2 * (colIdx + 1) + 1;
-			A[rowIdx][colIdx] = thetaPower[pw - 3];
-		}
-	}
-	return A;
+		unprojectBatch(fixed, u, v, x, y, z, n);
+	});
 }
 
 /**
-* @brief Construct matrix B to solve AK=B, for fitKannalaBrandt
-* @param radiusThetaPower [in] calculated radius*theta power from 3 to 2m+1, where m is kannala brandt order
-* @param thetaPower       [in] calculated theta power from 3 to 4m+2, where m is kannala brandt order
-* @return calculated matrix B
+* @brief least squares fit of r - theta on theta^3 ... theta^(2m-1), in
+*        one pass over the curve. with x = theta / thetaMax the basis is
+*        x^3 * T_j(2x^2 - 1), T_j the chebyshev polynomials, which spans
+*        the same odd powers but keeps the normal equations well
+*        conditioned, where theta power sums break down beyond order 5.
+*        sums are in double, the solution is turned back into powers of
+*        theta at the end. this is for fitKannalaBrandt
+* @param cam [in]  cam model
+* @param K   [out] coef k2 ... km, where m is kannala brandt order
+* @return success flag, CFALSE if the curve does not fix every coef
 */
-static Matrix constructMatrixB(std::vector<float32_t> radiusThetaPower, std::vector<float32_t> thetaPower)
+template <int32_t Order>
+static CFlags lsqKannalaBrandt(CamInt* cam, SMatrix<Order - 1, 1>& K)
 {
-	int32_t nRow = int32_t(thetaPower.size() / 4) - 1;
-	Matrix B = zeros(nRow, 1);
-	for (int32_t rowIdx = 0; rowIdx < nRow; rowIdx++)
+	constexpr int32_t N = Order - 1;
+	float64_t thetaScale = curveAngle(cam, cam->dCurveSize - 1)*DEG2RAD;
+	if (!(thetaScale > 0))
 	{
-		int32_t pw = 2 * (rowIdx + 1) + 1;
-		B[rowIdx][0] = radiusThetaPower[pw - 3] - thetaPower[pw - 2];
+		return CFALSE;
+	}
+
+	SMatrix<N, N> A;
+	SMatrix<N, 1> B;
+	for (int32_t thetaIdx = 0; thetaIdx < cam->dCurveSize; thetaIdx++)
+	{
+		float64_t theta = curveAngle(cam, thetaIdx)*DEG2RAD;
+		float64_t x = theta / thetaScale;
+		float64_t t = 2.0 * x * x - 1.0;
+		float64_t basis[N];
+		basis[0] = x * x * x;
+		if constexpr (N > 1)
+		{
+			basis[1] = basis[0] * t;
+		}
+		for (int32_t idx = 2; idx < N; idx++)
+		{
+			basis[idx] = 2.0 * t * basis[idx - 1] - basis[idx - 2];
+		}
+		float64_t residual = cam->dRadius[thetaIdx] - theta;
+		for (int32_t rowIdx = 0; rowIdx < N; rowIdx++)
+		{
+			for (int32_t colIdx = 0; colIdx <= rowIdx; colIdx++)
+			{
+				A[rowIdx][colIdx] += basis[rowIdx] * basis[colIdx];
+			}
+			B[rowIdx][0] += basis[rowIdx] * residual;
+		}
+	}
+	for (int32_t rowIdx = 0; rowIdx < N; rowIdx++)
+	{
+		for (int32_t colIdx = rowIdx + 1; colIdx < N; colIdx++)
+		{
+			A[rowIdx][colIdx] = A[colIdx][rowIdx];
+		}
 	}
-	return B;
-}
\ No newline at end of file
+
+	/* A is the normal matrix of the least squares fit, symmetric positive definite */
+	SMatrix<N, 1> C;
+	if (!solveSPD(A, B, C))
+	{
+		return CFALSE;
+	}
+
+	/* sum c_j * T_j(t) as powers of t, T_1 = t, T_(j+1) = 2t * T_j - T_(j-1) */
+	float64_t powT[N] = {};
+	float64_t chebPrev[N] = {};
+	float64_t chebCur[N] = {};
+	chebCur[0] = 1.0;
+	for (int32_t idx = 0; idx < N; idx++)
+	{
+		for (int32_t pw = 0; pw <= idx; pw++)
+		{
+			powT[pw] += C[idx][0] * chebCur[pw];
+		}
+		float64_t chebNext[N] = {};
+		for (int32_t pw = 0; pw <= idx && pw + 1 < N; pw++)
+		{
+			chebNext[pw + 1] = ((idx > 0) ? 2.0 : 1.0) * chebCur[pw];
+		}
+		for (int32_t pw = 0; pw < N; pw++)
+		{
+			chebNext[pw] -= (idx > 0) ? chebPrev[pw] : 0.0;
+			chebPrev[pw] = chebCur[pw];
+			chebCur[pw] = chebNext[pw];
+		}
+	}
+
+	/* powers of t to powers of x^2 by horner, t = 2x^2 - 1 */
+	float64_t powX2[N] = {};
+	for (int32_t idx = N - 1; idx >= 0; idx--)
+	{
+		for (int32_t pw = N - 1; pw > 0; pw--)
+		{
+			powX2[pw] = 2.0 * powX2[pw - 1] - powX2[pw];
+		}
+		powX2[0] = powT[idx] - powX2[0];
+	}
+
+	/* back from scaled theta, k * theta^p = k * thetaScale^p * x^p */
+	float64_t scalePow = thetaScale * thetaScale * thetaScale;
+	for (int32_t kIdx = 0; kIdx < N; kIdx++)
+	{
+		K[kIdx][0] = powX2[kIdx] / scalePow;
+		scalePow *= thetaScale * thetaScale;
+	}
+	return CTRUE;
+}
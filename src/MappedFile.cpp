@@ -0,0 +1,91 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: read-only memory mapped file, the mapping lives as long as
+*              the object, standalone so matrix.h and the loaders can use it
+*/
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(MappedFile&& f) noexcept
+	: addr(f.addr), length(f.length), opened(f.opened)
+{
+	f.addr = NULL;
+	f.length = 0;
+	f.opened = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& f) noexcept
+{
+	if (this != &f)
+	{
+		close();
+		addr = f.addr;
+		length = f.length;
+		opened = f.opened;
+		f.addr = NULL;
+		f.length = 0;
+		f.opened = false;
+	}
+	return *this;
+}
+
+/**
+* Map the whole file read-only, pages are loaded on first touch,
+* an empty file opens with size 0 and no data
+* @param path [in] file path
+* @return false if the file could not be opened or mapped
+*/
+bool MappedFile::open(const char* path)
+{
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if ((0 != fstat(fd, &st)) || !S_ISREG(st.st_mode))
+	{
+		::close(fd);
+		return false;
+	}
+
+	if (st.st_size > 0)
+	{
+		void* p = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (MAP_FAILED == p)
+		{
+			::close(fd);
+			return false;
+		}
+		addr = p;
+		length = size_t(st.st_size);
+	}
+	/* the mapping stays valid after the descriptor is closed */
+	::close(fd);
+	opened = true;
+	return true;
+}
+
+/**
+* Unmap the file, data() is invalid afterwards
+* @return void return
+*/
+void MappedFile::close()
+{
+	if (NULL != addr)
+	{
+		munmap(addr, length);
+	}
+	addr = NULL;
+	length = 0;
+	opened = false;
+	return;
+}
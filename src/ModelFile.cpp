@@ -0,0 +1,316 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: binary camera model file, loaded with mmap and one copy
+*/
+#include "ModelFile.h"
+#include "MappedFile.h"
+#include <array>
+#include <stdio.h>
+
+static_assert(sizeof(ModelFileHeader) == 64, "ModelFileHeader must be 64 bytes");
+
+/**
+* @brief CRC-32 (IEEE 802.3, reflected 0xEDB88320) lookup table
+* @return table of all byte values
+*/
+static constexpr std::array<uint32_t, 256> crcTable()
+{
+	std::array<uint32_t, 256> table = {};
+	for (uint32_t idx = 0; idx < 256; idx++)
+	{
+		uint32_t c = idx;
+		for (int32_t bit = 0; bit < 8; bit++)
+		{
+			c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+		}
+		table[idx] = c;
+	}
+	return table;
+}
+
+static constexpr std::array<uint32_t, 256> CRC_TABLE = crcTable();
+
+/**
+* @brief update CRC-32 with a block of bytes
+* @param crc  [in] CRC-32 so far, 0 to start
+* @param data [in] bytes
+* @param size [in] number of bytes
+* @return updated CRC-32
+*/
+static uint32_t crc32(uint32_t crc, const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	crc = ~crc;
+	for (size_t idx = 0; idx < size; idx++)
+	{
+		crc = CRC_TABLE[(crc ^ p[idx]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+/**
+* @brief reverse the bytes of 4 byte words in place
+* @param data  [in/out] words
+* @param count [in]     number of words
+* @return void return
+*/
+static void swapWords(void* data, size_t count)
+{
+	uint8_t* p = (uint8_t*)data;
+	for (size_t idx = 0; idx < count; idx++, p += 4)
+	{
+		uint8_t t0 = p[0];
+		uint8_t t1 = p[1];
+		p[0] = p[3];
+		p[1] = p[2];
+		p[2] = t1;
+		p[3] = t0;
+	}
+}
+
+/**
+* @brief check whether a file is a binary camera model by its magic
+* @param path [in] model path
+* @return CTRUE if the file starts with MODEL_FILE_MAGIC
+*/
+CFlags isModelFile(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (NULL == file)
+	{
+		return CFALSE;
+	}
+	char magic[4] = { 0 };
+	size_t n = fread(magic, 1, sizeof(magic), file);
+	fclose(file);
+	return ((sizeof(magic) == n) && (0 == memcmp(magic, MODEL_FILE_MAGIC, sizeof(magic)))) ? CTRUE : CFALSE;
+}
+
+/**
+* @brief save camera model as binary file
+* @param path  [in] save path
+* @param model [in] camera model, CamInt or CamIntKannalaBrandt
+* @param type  [in] camera model type, align with [CameraModel]
+* @return success flag
+*/
+CFlags saveModelFile(const char* path, void* model, int32_t type)
+{
+	ModelFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic));
+	header.version = MODEL_FILE_VERSION;
+	header.byteOrder = MODEL_FILE_BYTE_ORDER;
+	header.type = type;
+
+	const float32_t* payload = NULL;
+	CurveBuffer curve2Save;
+	switch (type)
+	{
+	case UNIVERSAL:
+	{
+		CamInt* cam = (CamInt*)model;
+		header.imgW = cam->imgW;
+		header.imgH = cam->imgH;
+		header.count = cam->dCurveSize;
+		header.param[0] = cam->cu;
+		header.param[1] = cam->cv;
+		header.param[2] = cam->c;
+		header.param[3] = cam->d;
+		header.param[4] = cam->e;
+		header.param[5] = cam->fu;
+		header.param[6] = cam->fv;
+		header.param[7] = cam->dStep;
+		/* the file keeps (angle, radius) pairs, uniform angles are written out */
+		if (!cam->dRadius.empty())
+		{
+			curve2Save.allocate(2 * (size_t)cam->dCurveSize);
+			for (int32_t idx = 0; idx < cam->dCurveSize; idx++)
+			{
+				curve2Save[2 * idx] = curveAngle(cam, idx);
+				curve2Save[2 * idx + 1] = cam->dRadius[idx];
+			}
+		}
+		payload = curve2Save.data();
+		header.count = (NULL == payload) ? 0 : header.count;
+		break;
+	}
+	case KANNALA_BRANDT:
+	{
+		CamIntKannalaBrandt* kbModel = (CamIntKannalaBrandt*)model;
+		if ((int32_t)kbModel->k.size() < kbModel->order)
+		{
+			CLOG_E("KannalaBrandt model has %d coef, order is %d\n", (int32_t)kbModel->k.size(), kbModel->order);
+			return CFALSE;
+		}
+		header.imgW = kbModel->imgWidth;
+		header.imgH = kbModel->imgHeight;
+		header.count = kbModel->order;
+		header.param[0] = kbModel->cu;
+		header.param[1] = kbModel->cv;
+		header.param[2] = kbModel->mu;
+		header.param[3] = kbModel->mv;
+		payload = kbModel->k.data();
+		break;
+	}
+	default:
+		CLOG_E("Unsupported camera model type!\n");
+		return CFALSE;
+	}
+
+	size_t payloadSize = (size_t)header.count * ((UNIVERSAL == type) ? 2 : 1) * sizeof(float32_t);
+	header.checksum = crc32(crc32(0, &header, sizeof(header)), payload, payloadSize);
+
+	FILE* file2Save = fopen(path, "wb");
+	if (NULL == file2Save)
+	{
+		CLOG_E("Could not open %s\n", path);
+		return CFALSE;
+	}
+	fwrite(&header, sizeof(header), 1, file2Save);
+	if (payloadSize > 0)
+	{
+		fwrite(payload, payloadSize, 1, file2Save);
+	}
+	fclose(file2Save);
+	return CTRUE;
+}
+
+/**
+* @brief load binary camera model, the file is mapped, checked and the
+*        payload split once into angles that must be strictly increasing and
+*        radii, files from the other byte order are swapped
+* @param path    [in]  model path
+* @param type    [out] camera model type, align with [CameraModel]
+* @param cam     [out] UNIVERSAL model, dRadius and dAngle are allocated here
+* @param kbModel [out] KANNALA_BRANDT model
+* @return success flag
+*/
+CFlags loadModelFile(const char* path, int32_t* type, CamInt* cam, CamIntKannalaBrandt* kbModel)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		CLOG_E("Could not open %s\n", path);
+		return CFALSE;
+	}
+
+	ModelFileHeader header;
+	if ((file.size() < sizeof(header)) || (0 != memcmp(file.data(), MODEL_FILE_MAGIC, sizeof(header.magic))))
+	{
+		CLOG_E("%s is not a binary camera model\n", path);
+		return CFALSE;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+
+	bool swapped = (MODEL_FILE_BYTE_ORDER != header.byteOrder);
+	if (swapped)
+	{
+		swapWords(&header.version, (sizeof(header) - sizeof(header.magic)) / 4);
+		if (MODEL_FILE_BYTE_ORDER != header.byteOrder)
+		{
+			CLOG_E("%s has an unknown byte order\n", path);
+			return CFALSE;
+		}
+	}
+	if ((header.version < 1) || (header.version > MODEL_FILE_VERSION))
+	{
+		CLOG_E("%s has unsupported version %u\n", path, header.version);
+		return CFALSE;
+	}
+
+	int32_t lanes = 0;
+	if ((UNIVERSAL == header.type) && (header.count >= 2) && (header.count <= MODEL_FILE_MAX_CURVE))
+	{
+		lanes = 2;
+	}
+	else if ((KANNALA_BRANDT == header.type) && (header.count >= 1) && (header.count <= KB_MAX_ORDER))
+	{
+		lanes = 1;
+	}
+	else
+	{
+		CLOG_E("%s has unsupported model type %d of size %d\n", path, header.type, header.count);
+		return CFALSE;
+	}
+
+	size_t payloadSize = (size_t)header.count * lanes * sizeof(float32_t);
+	if (file.size() != sizeof(header) + payloadSize)
+	{
+		CLOG_E("%s has %zu bytes, expected %zu\n", path, file.size(), sizeof(header) + payloadSize);
+		return CFALSE;
+	}
+
+	/* checksum covers the bytes as written */
+	const char* payload = file.data() + sizeof(header);
+	ModelFileHeader raw;
+	memcpy(&raw, file.data(), sizeof(raw));
+	uint32_t checksum = header.checksum;
+	raw.checksum = 0;
+	if (checksum != crc32(crc32(0, &raw, sizeof(raw)), payload, payloadSize))
+	{
+		CLOG_E("%s checksum mismatch\n", path);
+		return CFALSE;
+	}
+
+	*type = header.type;
+	if (UNIVERSAL == header.type)
+	{
+		if (!(header.param[7] > 0.0F))
+		{
+			CLOG_E("%s has invalid disortion step %f\n", path, header.param[7]);
+			return CFALSE;
+		}
+		cam->imgW = header.imgW;
+		cam->imgH = header.imgH;
+		cam->cu = header.param[0];
+		cam->cv = header.param[1];
+		cam->c = header.param[2];
+		cam->d = header.param[3];
+		cam->e = header.param[4];
+		cam->fu = header.param[5];
+		cam->fv = header.param[6];
+		cam->dStep = header.param[7];
+		cam->dCurveSize = header.count;
+		/* split the interleaved pairs straight from the map */
+		CurveBuffer angle2Load(header.count);
+		CurveBuffer radius2Load(header.count);
+		for (int32_t idx = 0; idx < (int32_t)header.count; idx++)
+		{
+			memcpy(&angle2Load[idx], payload + (2 * idx) * sizeof(float32_t), sizeof(float32_t));
+			memcpy(&radius2Load[idx], payload + (2 * idx + 1) * sizeof(float32_t), sizeof(float32_t));
+			if (swapped)
+			{
+				swapWords(&angle2Load[idx], 1);
+				swapWords(&radius2Load[idx], 1);
+			}
+			if ((idx > 0) && !(angle2Load[idx] > angle2Load[idx - 1]))
+			{
+				CLOG_E("%s angle is not increasing at point %d\n", path, idx);
+				return CFALSE;
+			}
+		}
+		cam->dAngle = std::move(angle2Load);
+		cam->dRadius = std::move(radius2Load);
+		dropUniformAngles(cam);
+	}
+	else
+	{
+		kbModel->imgWidth = header.imgW;
+		kbModel->imgHeight = header.imgH;
+		kbModel->cu = header.param[0];
+		kbModel->cv = header.param[1];
+		kbModel->mu = header.param[2];
+		kbModel->mv = header.param[3];
+		kbModel->order = (uint8_t)header.count;
+		kbModel->k.resize(header.count);
+		memcpy(kbModel->k.data(), payload, payloadSize);
+		if (swapped)
+		{
+			swapWords(kbModel->k.data(), header.count);
+		}
+	}
+	return CTRUE;
+}
@@ -0,0 +1,1094 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: dense remap maps between a camera model and a virtual pinhole
+*/
+#include "Remap.h"
+#include "KannalaBrandt.h"
+#include "simd.h"
+#include <float.h>
+#include <stdio.h>
+
+/**
+* @brief image size and optic center of a camera model
+* @param model [in]  camera model
+* @param type  [in]  camera model type, align with [CameraModel]
+* @param w     [out] image width
+* @param h     [out] image height
+* @param cu    [out] optic center, u
+* @param cv    [out] optic center, v
+* @return success flag
+*/
+static CFlags modelGeometry(void* model, int32_t type, int32_t* w, int32_t* h, float32_t* cu, float32_t* cv)
+{
+	CFlags ret = CTRUE;
+	switch (type)
+	{
+	case UNIVERSAL:
+		*w = ((CamInt*)model)->imgW;
+		*h = ((CamInt*)model)->imgH;
+		*cu = ((CamInt*)model)->cu;
+		*cv = ((CamInt*)model)->cv;
+		break;
+	case KANNALA_BRANDT:
+		*w = ((CamIntKannalaBrandt*)model)->imgWidth;
+		*h = ((CamIntKannalaBrandt*)model)->imgHeight;
+		*cu = ((CamIntKannalaBrandt*)model)->cu;
+		*cv = ((CamIntKannalaBrandt*)model)->cv;
+		break;
+	default:
+		CLOG_E("Unsupported camera model type!\n");
+		ret = CFALSE;
+		break;
+	}
+	return ret;
+}
+
+/**
+* @brief project points with the camera model, see projectUniversal
+*/
+static CFlags modelProject(void* model, int32_t type, const float32_t* x, const float32_t* y, const float32_t* z,
+	float32_t* u, float32_t* v, int32_t n)
+{
+	if (UNIVERSAL == type)
+	{
+		return projectUniversal((CamInt*)model, x, y, z, u, v, n);
+	}
+	return projectKannalaBrandt((CamIntKannalaBrandt*)model, x, y, z, u, v, n);
+}
+
+/**
+* @brief unproject pixels with the camera model, see unprojectUniversal
+*/
+static CFlags modelUnproject(void* model, int32_t type, const float32_t* u, const float32_t* v,
+	float32_t* x, float32_t* y, float32_t* z, int32_t n)
+{
+	if (UNIVERSAL == type)
+	{
+		return unprojectUniversal((CamInt*)model, u, v, x, y, z, n);
+	}
+	return unprojectKannalaBrandt((CamIntKannalaBrandt*)model, u, v, x, y, z, n);
+}
+
+/**
+* @brief set a virtual pinhole camera sharing the image size and optic
+*        center of the camera model
+* @param pin   [out] virtual pinhole camera
+* @param model [in]  camera model
+* @param type  [in]  camera model type, align with [CameraModel]
+* @param fov   [in]  horizontal field of view, in degree
+* @return success flag
+*/
+CFlags setVirtualPinhole(PinholeInt* pin, void* model, int32_t type, float32_t fov)
+{
+	if ((fov <= 0.0F) || (fov >= 180.0F))
+	{
+		CLOG_E("Virtual pinhole fov shall be in (0, 180) degree, got %f\n", fov);
+		return CFALSE;
+	}
+	if (CTRUE != modelGeometry(model, type, &pin->imgW, &pin->imgH, &pin->cu, &pin->cv))
+	{
+		return CFALSE;
+	}
+	pin->fu = float32_t(0.5*pin->imgW / tan(0.5*fov*DEG2RAD));
+	pin->fv = pin->fu;
+	return CTRUE;
+}
+
+/**
+* @brief fill one tile of the remap map
+* @param map    [out] remap map
+* @param model  [in]  camera model
+* @param type   [in]  camera model type
+* @param pin    [in]  virtual pinhole camera
+* @param dir    [in]  remap direction
+* @param tileX  [in]  tile column
+* @param tileY  [in]  tile row
+* @return void return
+*/
+static void remapTile(RemapMap* map, void* model, int32_t type, PinholeInt* pin, RemapDirection dir,
+	int32_t tileX, int32_t tileY)
+{
+	float32_t bufA[REMAP_TILE_W], bufB[REMAP_TILE_W], bufC[REMAP_TILE_W];
+	float32_t bufU[REMAP_TILE_W], bufV[REMAP_TILE_W];
+	int32_t x0 = tileX*REMAP_TILE_W;
+	int32_t y0 = tileY*REMAP_TILE_H;
+	int32_t nCol = MIN(REMAP_TILE_W, map->width - x0);
+	int32_t nRow = MIN(REMAP_TILE_H, map->height - y0);
+	for (int32_t row = y0; row < y0 + nRow; row++)
+	{
+		float32_t* pU = map->mapU + (size_t)row*map->width + x0;
+		float32_t* pV = map->mapV + (size_t)row*map->width + x0;
+		if (FISHEYE_TO_PINHOLE == dir)
+		{/* pinhole pixel -> ray -> fisheye pixel */
+			float32_t rayY = (row - pin->cv) / pin->fv;
+			for (int32_t col = 0; col < nCol; col++)
+			{
+				bufA[col] = (x0 + col - pin->cu) / pin->fu;
+				bufB[col] = rayY;
+				bufC[col] = 1.0F;
+			}
+			modelProject(model, type, bufA, bufB, bufC, pU, pV, nCol);
+		}
+		else
+		{/* fisheye pixel -> ray -> pinhole pixel */
+			for (int32_t col = 0; col < nCol; col++)
+			{
+				bufU[col] = float32_t(x0 + col);
+				bufV[col] = float32_t(row);
+			}
+			modelUnproject(model, type, bufU, bufV, bufA, bufB, bufC, nCol);
+			for (int32_t col = 0; col < nCol; col++)
+			{
+				/* rays at or behind the pinhole image plane have no source */
+				bool valid = bufC[col] > 1e-6F;
+				float32_t invZ = valid ? 1.0F / bufC[col] : 0.0F;
+				pU[col] = valid ? pin->cu + pin->fu*bufA[col] * invZ : REMAP_INVALID;
+				pV[col] = valid ? pin->cv + pin->fv*bufB[col] * invZ : REMAP_INVALID;
+			}
+		}
+	}
+	return;
+}
+
+/**
+* @brief build full resolution remap maps between a camera model and a
+*        virtual pinhole camera
+* @param map   [out] remap map, released by releaseRemap
+* @param model [in]  camera model, CamInt or CamIntKannalaBrandt
+* @param type  [in]  camera model type, align with [CameraModel]
+* @param pin   [in]  virtual pinhole camera
+* @param dir   [in]  remap direction
+* @param pool  [in]  thread pool
+* @return success flag
+*/
+CFlags buildRemap(RemapMap* map, void* model, int32_t type, PinholeInt* pin, RemapDirection dir, ThreadPool* pool)
+{
+	int32_t modelW, modelH;
+	float32_t modelCu, modelCv;
+	if ((NULL == model) || (CTRUE != modelGeometry(model, type, &modelW, &modelH, &modelCu, &modelCv)))
+	{
+		return CFALSE;
+	}
+	/* lazily built lookup tables shall exist before the tiles share the model */
+	if ((UNIVERSAL == type) && ((CamInt*)model)->rLut.empty() && (CTRUE != buildRadiusLut((CamInt*)model)))
+	{
+		return CFALSE;
+	}
+
+	releaseRemap(map);
+	map->width = (FISHEYE_TO_PINHOLE == dir) ? pin->imgW : modelW;
+	map->height = (FISHEYE_TO_PINHOLE == dir) ? pin->imgH : modelH;
+	if ((map->width <= 0) || (map->height <= 0))
+	{
+		CLOG_E("Invalid remap size %d x %d\n", map->width, map->height);
+		return CFALSE;
+	}
+	map->mapU = new float32_t[(size_t)map->width*map->height];
+	map->mapV = new float32_t[(size_t)map->width*map->height];
+
+	int32_t nTileX = (map->width + REMAP_TILE_W - 1) / REMAP_TILE_W;
+	int32_t nTileY = (map->height + REMAP_TILE_H - 1) / REMAP_TILE_H;
+	pool->parallelFor(nTileX*nTileY, [&](int32_t tileIdx)
+	{
+		remapTile(map, model, type, pin, dir, tileIdx % nTileX, tileIdx / nTileX);
+	});
+	return CTRUE;
+}
+
+/**
+* @brief save remap maps as binary file
+* @param path [in] save path
+* @param map  [in] remap map
+* @return success flag
+*/
+CFlags saveRemap(const char* path, RemapMap* map)
+{
+	FILE* file2Save = fopen(path, "wb");
+	if (NULL == file2Save)
+	{
+		CLOG_E("Could not open %s\n", path);
+		return CFALSE;
+	}
+	char flag[12] = "REMAP_DATA";
+	size_t nPixel = (size_t)map->width*map->height;
+	fwrite(flag, sizeof(flag), 1, file2Save);
+	fwrite(&map->width, sizeof(int32_t), 1, file2Save);
+	fwrite(&map->height, sizeof(int32_t), 1, file2Save);
+	fwrite(map->mapU, sizeof(float32_t), nPixel, file2Save);
+	fwrite(map->mapV, sizeof(float32_t), nPixel, file2Save);
+	fclose(file2Save);
+	return CTRUE;
+}
+
+/**
+* @brief release remap maps
+* @param map [in] remap map
+* @return void return
+*/
+void releaseRemap(RemapMap* map)
+{
+	delete[] map->mapU;
+	delete[] map->mapV;
+	map->mapU = NULL;
+	map->mapV = NULL;
+	map->width = 0;
+	map->height = 0;
+	return;
+}
+
+/**
+* @brief fixed point source of one output pixel
+* @param u    [in]  source u
+* @param v    [in]  source v
+* @param srcW [in]  source image width
+* @param srcH [in]  source image height
+* @param xy   [out] source top-left x | y << 16
+* @param frac [out] fraction fx | fy << 8
+* @return void return
+*/
+static inline void toFixed(float32_t u, float32_t v, int32_t srcW, int32_t srcH, int32_t* xy, uint16_t* frac)
+{
+	/* written so that NaN has no source too */
+	if (!((u >= 0.0F) && (v >= 0.0F) && (u <= srcW - 1) && (v <= srcH - 1)))
+	{
+		*xy = REMAP_NO_SOURCE;
+		*frac = 0;
+		return;
+	}
+	int32_t uFix = int32_t(u*REMAP_FRAC_ONE + 0.5F);
+	int32_t vFix = int32_t(v*REMAP_FRAC_ONE + 0.5F);
+	int32_t x = uFix >> REMAP_FRAC_BITS;
+	int32_t y = vFix >> REMAP_FRAC_BITS;
+	int32_t fx = uFix & (REMAP_FRAC_ONE - 1);
+	int32_t fy = vFix & (REMAP_FRAC_ONE - 1);
+	/* last column / row, keep the footprint inside and weight the far pixel fully */
+	if (x > srcW - 2)
+	{
+		x = srcW - 2;
+		fx = REMAP_FRAC_ONE;
+	}
+	if (y > srcH - 2)
+	{
+		y = srcH - 2;
+		fy = REMAP_FRAC_ONE;
+	}
+	*xy = x | (y << 16);
+	*frac = uint16_t(fx | (fy << 8));
+	return;
+}
+
+/**
+* @brief fixed point source of a row of output pixels, same result as toFixed
+* @param u    [in]  source u
+* @param v    [in]  source v
+* @param n    [in]  number of pixels
+* @param srcW [in]  source image width
+* @param srcH [in]  source image height
+* @param xy   [out] source top-left x | y << 16
+* @param frac [out] fraction fx | fy << 8
+* @return void return
+*/
+static void toFixedRow(const float32_t* u, const float32_t* v, int32_t n, int32_t srcW, int32_t srcH,
+	int32_t* xy, uint16_t* frac)
+{
+	int32_t idx = 0;
+	for (; idx + SIMD_WIDTH <= n; idx += SIMD_WIDTH)
+	{
+		vf32 vu = vLoad(u + idx);
+		vf32 vv = vLoad(v + idx);
+		vm32 inside = vmAnd(vmAnd(vCmpGe(vu, vSet1(0.0F)), vCmpGe(vv, vSet1(0.0F))),
+			vmAnd(vCmpLe(vu, vSet1(float32_t(srcW - 1))), vCmpLe(vv, vSet1(float32_t(srcH - 1)))));
+		/* convert 0 in lanes without source, out of range floats do not convert */
+		vu = vSelect(inside, vu, vSet1(0.0F));
+		vv = vSelect(inside, vv, vSet1(0.0F));
+		vi32 uFix = vCvtTrunc(vFmadd(vu, vSet1(float32_t(REMAP_FRAC_ONE)), vSet1(0.5F)));
+		vi32 vFix = vCvtTrunc(vFmadd(vv, vSet1(float32_t(REMAP_FRAC_ONE)), vSet1(0.5F)));
+		vi32 x = viSrl(uFix, REMAP_FRAC_BITS);
+		vi32 y = viSrl(vFix, REMAP_FRAC_BITS);
+		vi32 fx = viAnd(uFix, viSet1(REMAP_FRAC_ONE - 1));
+		vi32 fy = viAnd(vFix, viSet1(REMAP_FRAC_ONE - 1));
+		/* x > srcW - 2 only at x = srcW - 1 with fraction 0, step back and weight the far pixel */
+		vi32 lastX = viCmpGt(x, viSet1(srcW - 2));
+		vi32 lastY = viCmpGt(y, viSet1(srcH - 2));
+		x = viAdd(x, lastX);
+		y = viAdd(y, lastY);
+		fx = viSub(fx, viSll(lastX, REMAP_FRAC_BITS));
+		fy = viSub(fy, viSll(lastY, REMAP_FRAC_BITS));
+		vi32 valid = viFromMask(inside);
+		viStore(xy + idx, viOr(viAnd(viOr(x, viSll(y, 16)), valid), viCmpEq(valid, viSet1(0))));
+		viStoreU16(frac + idx, viAnd(viOr(fx, viSll(fy, 8)), valid));
+	}
+	for (; idx < n; idx++)
+	{
+		toFixed(u[idx], v[idx], srcW, srcH, xy + idx, frac + idx);
+	}
+	return;
+}
+
+/**
+* @brief convert remap maps to fixed point for a source image size
+* @param fixed  [out] fixed point map, released by releaseRemapFixed
+* @param map    [in]  remap map
+* @param srcW   [in]  source image width, in [2, 32767]
+* @param srcH   [in]  source image height, in [2, 32767]
+* @param format [in]  image format, IMAGE_NV12 also builds the chroma map
+* @return success flag
+*/
+CFlags convertRemapFixed(RemapFixed* fixed, RemapMap* map, int32_t srcW, int32_t srcH, ImageFormat format)
+{
+	if ((srcW < 2) || (srcH < 2) || (srcW > 32767) || (srcH > 32767))
+	{
+		CLOG_E("Unsupported remap source size %d x %d\n", srcW, srcH);
+		return CFALSE;
+	}
+	if ((IMAGE_NV12 == format) && ((srcW % 4) || (srcH % 4) || (map->width % 2) || (map->height % 2)))
+	{
+		CLOG_E("NV12 remap needs even output size and source size divisible by 4\n");
+		return CFALSE;
+	}
+	releaseRemapFixed(fixed);
+	fixed->width = map->width;
+	fixed->height = map->height;
+	fixed->srcW = srcW;
+	fixed->srcH = srcH;
+	size_t nPixel = (size_t)map->width*map->height;
+	fixed->xy = new int32_t[nPixel];
+	fixed->frac = new uint16_t[nPixel];
+	for (size_t idx = 0; idx < nPixel; idx++)
+	{
+		toFixed(map->mapU[idx], map->mapV[idx], srcW, srcH, fixed->xy + idx, fixed->frac + idx);
+	}
+	if (IMAGE_NV12 == format)
+	{/* chroma sample (i, j) sits at luma (2i + 0.5, 2j + 0.5), use the mean source of its 2x2 luma block */
+		int32_t wUV = map->width / 2;
+		int32_t hUV = map->height / 2;
+		fixed->xyUV = new int32_t[(size_t)wUV*hUV];
+		fixed->fracUV = new uint16_t[(size_t)wUV*hUV];
+		for (int32_t row = 0; row < hUV; row++)
+		{
+			for (int32_t col = 0; col < wUV; col++)
+			{
+				size_t idx00 = (size_t)(2 * row)*map->width + 2 * col;
+				size_t idx10 = idx00 + map->width;
+				float32_t u = 0.25F*(map->mapU[idx00] + map->mapU[idx00 + 1] + map->mapU[idx10] + map->mapU[idx10 + 1]);
+				float32_t v = 0.25F*(map->mapV[idx00] + map->mapV[idx00 + 1] + map->mapV[idx10] + map->mapV[idx10 + 1]);
+				bool valid = (REMAP_NO_SOURCE != fixed->xy[idx00]) && (REMAP_NO_SOURCE != fixed->xy[idx00 + 1]) &&
+					(REMAP_NO_SOURCE != fixed->xy[idx10]) && (REMAP_NO_SOURCE != fixed->xy[idx10 + 1]);
+				if (valid)
+				{
+					u = MIN(MAX(0.5F*(u - 0.5F), 0.0F), float32_t(srcW / 2 - 1));
+					v = MIN(MAX(0.5F*(v - 0.5F), 0.0F), float32_t(srcH / 2 - 1));
+				}
+				else
+				{
+					u = REMAP_INVALID;
+				}
+				toFixed(u, v, srcW / 2, srcH / 2, fixed->xyUV + (size_t)row*wUV + col, fixed->fracUV + (size_t)row*wUV + col);
+			}
+		}
+	}
+	return CTRUE;
+}
+
+/**
+* @brief release fixed point remap map
+* @param fixed [in] fixed point remap map
+* @return void return
+*/
+void releaseRemapFixed(RemapFixed* fixed)
+{
+	delete[] fixed->xy;
+	delete[] fixed->frac;
+	delete[] fixed->xyUV;
+	delete[] fixed->fracUV;
+	*fixed = RemapFixed();
+	return;
+}
+
+/**
+* @brief remap one pixel of C channels, scalar reference of remapSpan
+*/
+template <int32_t C>
+static inline void remapPixel(uint8_t* dst, const uint8_t* src, int32_t stride, int32_t xy, uint16_t frac)
+{
+	/* no source reads pixel 0 and writes 0, no branch in the hot loop */
+	int32_t valid = (REMAP_NO_SOURCE == xy) ? 0 : 0xFF;
+	xy &= -(valid & 1);
+	const uint8_t* p = src + (size_t)(xy >> 16)*stride + (xy & 0xFFFF)*C;
+	int32_t fx = frac & 0xFF;
+	int32_t fy = frac >> 8;
+	for (int32_t ch = 0; ch < C; ch++)
+	{
+		int32_t top = (p[ch] << REMAP_FRAC_BITS) + (p[C + ch] - p[ch])*fx;
+		int32_t bot = (p[stride + ch] << REMAP_FRAC_BITS) + (p[stride + C + ch] - p[stride + ch])*fx;
+		int32_t out = (top << REMAP_FRAC_BITS) + (bot - top)*fy + (1 << (2 * REMAP_FRAC_BITS - 1));
+		dst[ch] = uint8_t((out >> (2 * REMAP_FRAC_BITS)) & valid);
+	}
+	return;
+}
+
+/**
+* @brief fixed point bilinear blend of 2x2 footprints, per lane
+*/
+static inline vi32 vBilinear(vi32 p00, vi32 p01, vi32 p10, vi32 p11, vi32 fx, vi32 fy)
+{
+	vi32 top = viAdd(viSll(p00, REMAP_FRAC_BITS), viMul(viSub(p01, p00), fx));
+	vi32 bot = viAdd(viSll(p10, REMAP_FRAC_BITS), viMul(viSub(p11, p10), fx));
+	vi32 out = viAdd(viSll(top, REMAP_FRAC_BITS), viMul(viSub(bot, top), fy));
+	return viSrl(viAdd(out, viSet1(1 << (2 * REMAP_FRAC_BITS - 1))), 2 * REMAP_FRAC_BITS);
+}
+
+/**
+* @brief byte ch of each lane
+*/
+static inline vi32 vByte(vi32 a, int32_t ch)
+{
+	return viAnd(viSrl(a, 8 * ch), viSet1(0xFF));
+}
+
+/**
+* @brief remap a span of n output pixels of C channels
+* @param dst     [out] output pixels
+* @param src     [in]  source plane
+* @param stride  [in]  source bytes per row
+* @param safeOfs [in]  largest footprint offset whose 4 byte gathers stay in the source
+* @param xy      [in]  fixed map source pixels
+* @param frac    [in]  fixed map fractions
+* @param n       [in]  number of pixels
+* @return void return
+*/
+template <int32_t C>
+static void remapSpan(uint8_t* dst, const uint8_t* src, int32_t stride, int32_t safeOfs,
+	const int32_t* xy, const uint16_t* frac, int32_t n)
+{
+	int32_t idx = 0;
+	/* emulated gathers cost more than they save, those builds take the scalar loop */
+	for (; SIMD_HW_GATHER && (idx + SIMD_WIDTH <= n); idx += SIMD_WIDTH)
+	{
+		vi32 vxy = viLoad(xy + idx);
+		/* lanes without source gather at offset 0 and are cleared at the end */
+		vi32 valid = viCmpGt(vxy, viSet1(REMAP_NO_SOURCE));
+		vxy = viAnd(vxy, valid);
+		vi32 ofs = viAdd(viMul(viSrl(vxy, 16), viSet1(stride)), viMul(viAnd(vxy, viSet1(0xFFFF)), viSet1(C)));
+		if (viAny(viCmpGt(ofs, viSet1(safeOfs))))
+		{/* footprint at the very end of the source, gathers would read past it */
+			for (int32_t lane = 0; lane < SIMD_WIDTH; lane++)
+			{
+				remapPixel<C>(dst + (idx + lane)*C, src, stride, xy[idx + lane], frac[idx + lane]);
+			}
+			continue;
+		}
+		vi32 vFrac = viLoadU16(frac + idx);
+		vi32 fx = viAnd(vFrac, viSet1(0xFF));
+		vi32 fy = viSrl(vFrac, 8);
+		vi32 ofsBot = viAdd(ofs, viSet1(stride));
+		if (1 == C)
+		{/* one gather holds p00 p01 */
+			vi32 top = viGatherU8x4(src, ofs);
+			vi32 bot = viGatherU8x4(src, ofsBot);
+			vi32 out = vBilinear(vByte(top, 0), vByte(top, 1), vByte(bot, 0), vByte(bot, 1), fx, fy);
+			viStoreU8(dst + idx, viAnd(out, valid));
+		}
+		else if (2 == C)
+		{/* one gather holds u00 v00 u01 v01 */
+			vi32 top = viGatherU8x4(src, ofs);
+			vi32 bot = viGatherU8x4(src, ofsBot);
+			vi32 out0 = vBilinear(vByte(top, 0), vByte(top, 2), vByte(bot, 0), vByte(bot, 2), fx, fy);
+			vi32 out1 = vBilinear(vByte(top, 1), vByte(top, 3), vByte(bot, 1), vByte(bot, 3), fx, fy);
+			viStoreU16((uint16_t*)(dst + 2 * idx), viAnd(viOr(out0, viSll(out1, 8)), valid));
+		}
+		else
+		{/* p00 and p01 need one gather each */
+			vi32 top0 = viGatherU8x4(src, ofs);
+			vi32 top1 = viGatherU8x4(src, viAdd(ofs, viSet1(C)));
+			vi32 bot0 = viGatherU8x4(src, ofsBot);
+			vi32 bot1 = viGatherU8x4(src, viAdd(ofsBot, viSet1(C)));
+			vi32 out = viSet1(0);
+			for (int32_t ch = 0; ch < C; ch++)
+			{
+				vi32 outCh = vBilinear(vByte(top0, ch), vByte(top1, ch), vByte(bot0, ch), vByte(bot1, ch), fx, fy);
+				out = viOr(out, viSll(outCh, 8 * ch));
+			}
+			int32_t pixel[SIMD_WIDTH];
+			viStore(pixel, viAnd(out, valid));
+			for (int32_t lane = 0; lane < SIMD_WIDTH; lane++)
+			{
+				memcpy(dst + (idx + lane)*C, pixel + lane, C);
+			}
+		}
+	}
+	for (; idx < n; idx++)
+	{
+		remapPixel<C>(dst + idx*C, src, stride, xy[idx], frac[idx]);
+	}
+	return;
+}
+
+/**
+* @brief remap one plane of C channels tile by tile
+* @param dst       [out] output plane
+* @param dstStride [in]  output bytes per row
+* @param src       [in]  source plane
+* @param srcStride [in]  source bytes per row
+* @param srcW      [in]  source plane width
+* @param srcH      [in]  source plane height
+* @param mapW      [in]  map width
+* @param mapH      [in]  map height
+* @param fetch     [in]  fetch(row, x0, nCol, xyBuf, fracBuf, &xy, &frac) points xy, frac
+*                        at the fixed map of a tile row, the buffers hold REMAP_TILE_W
+*                        entries for maps made on the fly
+* @param pool      [in]  thread pool, could be NULL
+* @return void return
+*/
+template <int32_t C, typename Fetch>
+static void remapPlane(uint8_t* dst, int32_t dstStride, const uint8_t* src, int32_t srcStride, int32_t srcW, int32_t srcH,
+	int32_t mapW, int32_t mapH, const Fetch& fetch, ThreadPool* pool)
+{
+	/* the last row has no padding, the widest gather reads 4 bytes from the right neighbour */
+	int32_t srcBytes = (srcH - 1)*srcStride + srcW*C;
+	int32_t safeOfs = srcBytes - srcStride - 4 - ((3 == C) ? C : 0);
+	int32_t nTileX = (mapW + REMAP_TILE_W - 1) / REMAP_TILE_W;
+	int32_t nTileY = (mapH + REMAP_TILE_H - 1) / REMAP_TILE_H;
+	std::function<void(int32_t)> tile = [&](int32_t tileIdx)
+	{
+		int32_t xyBuf[REMAP_TILE_W];
+		uint16_t fracBuf[REMAP_TILE_W];
+		int32_t x0 = (tileIdx % nTileX)*REMAP_TILE_W;
+		int32_t y0 = (tileIdx / nTileX)*REMAP_TILE_H;
+		int32_t nCol = MIN(REMAP_TILE_W, mapW - x0);
+		int32_t nRow = MIN(REMAP_TILE_H, mapH - y0);
+		for (int32_t row = y0; row < y0 + nRow; row++)
+		{
+			const int32_t* xy = NULL;
+			const uint16_t* frac = NULL;
+			fetch(row, x0, nCol, xyBuf, fracBuf, &xy, &frac);
+			remapSpan<C>(dst + (size_t)row*dstStride + x0*C, src, srcStride, safeOfs, xy, frac, nCol);
+		}
+	};
+	if (NULL == pool)
+	{
+		for (int32_t tileIdx = 0; tileIdx < nTileX*nTileY; tileIdx++)
+		{
+			tile(tileIdx);
+		}
+	}
+	else
+	{
+		pool->parallelFor(nTileX*nTileY, tile);
+	}
+	return;
+}
+
+/**
+* @brief fetch tile rows from a precomputed fixed point map
+*/
+struct FixedFetch
+{
+	const int32_t* xy;
+	const uint16_t* frac;
+	int32_t mapW;
+	void operator()(int32_t row, int32_t x0, int32_t nCol, int32_t* xyBuf, uint16_t* fracBuf,
+		const int32_t** xyRow, const uint16_t** fracRow) const
+	{
+		*xyRow = xy + (size_t)row*mapW + x0;
+		*fracRow = frac + (size_t)row*mapW + x0;
+	}
+};
+
+/**
+* @brief apply a fixed point remap map to an image
+* @param dst   [out] output image, size of the map, same format as src
+* @param src   [in]  source image, size the map was converted for
+* @param fixed [in]  fixed point remap map
+* @param pool  [in]  thread pool to run tiles on, NULL runs on the calling thread
+* @return success flag
+*/
+CFlags remapImage(ImageU8* dst, const ImageU8* src, RemapFixed* fixed, ThreadPool* pool)
+{
+	if ((NULL == fixed->xy) || (src->format != dst->format) ||
+		(dst->width != fixed->width) || (dst->height != fixed->height) ||
+		(src->width != fixed->srcW) || (src->height != fixed->srcH))
+	{
+		CLOG_E("Image and remap map do not match\n");
+		return CFALSE;
+	}
+	FixedFetch luma = { fixed->xy, fixed->frac, fixed->width };
+	switch (src->format)
+	{
+	case IMAGE_GRAY:
+		remapPlane<1>(dst->data, dst->stride, src->data, src->stride, src->width, src->height,
+			fixed->width, fixed->height, luma, pool);
+		break;
+	case IMAGE_RGB:
+		remapPlane<3>(dst->data, dst->stride, src->data, src->stride, src->width, src->height,
+			fixed->width, fixed->height, luma, pool);
+		break;
+	case IMAGE_NV12:
+		if (NULL == fixed->xyUV)
+		{
+			CLOG_E("Remap map has no NV12 chroma map\n");
+			return CFALSE;
+		}
+		remapPlane<1>(dst->data, dst->stride, src->data, src->stride, src->width, src->height,
+			fixed->width, fixed->height, luma, pool);
+		remapPlane<2>(dst->dataUV, dst->stride, src->dataUV, src->stride, src->width / 2, src->height / 2,
+			fixed->width / 2, fixed->height / 2, FixedFetch{ fixed->xyUV, fixed->fracUV, fixed->width / 2 }, pool);
+		break;
+	default:
+		CLOG_E("Unsupported image format\n");
+		return CFALSE;
+	}
+	return CTRUE;
+}
+
+/**
+* @brief pixel affine of a camera model, pixel - center = A * r * (x, y) / rxy
+* @param model [in]  camera model
+* @param type  [in]  camera model type
+* @param A     [out] row major 2x2
+* @return void return
+*/
+static void modelAffine(void* model, int32_t type, float64_t A[4])
+{
+	if (UNIVERSAL == type)
+	{
+		CamInt* cam = (CamInt*)model;
+		float32_t mu, mv;
+		universalPixelScale(cam, &mu, &mv);
+		A[0] = float64_t(cam->c)*mu;
+		A[1] = float64_t(cam->d)*mv;
+		A[2] = float64_t(cam->e)*mu;
+		A[3] = mv;
+	}
+	else
+	{
+		CamIntKannalaBrandt* cam = (CamIntKannalaBrandt*)model;
+		A[0] = cam->mu;
+		A[1] = 0.0;
+		A[2] = 0.0;
+		A[3] = cam->mv;
+	}
+	return;
+}
+
+/**
+* @brief exact radial scale at |in|^2 = k, sampled through the model batch API
+*        along the in.x axis
+* @param radial [in]  radial remap, matrices set
+* @param model  [in]  camera model
+* @param type   [in]  camera model type
+* @param dir    [in]  remap direction
+* @param k      [in]  squared normalized radius
+* @param scale  [out] scale, -FLT_MAX without source
+* @param n      [in]  number of samples
+* @return void return
+*/
+static void radialScale(RemapRadial* radial, void* model, int32_t type, RemapDirection dir,
+	const float32_t* k, float32_t* scale, int32_t n)
+{
+	float64_t A[4];
+	modelAffine(model, type, A);
+	const int32_t chunk = 256;
+	float32_t bufA[chunk], bufB[chunk], bufC[chunk], bufU[chunk], bufV[chunk], bufR[chunk];
+	for (int32_t idx0 = 0; idx0 < n; idx0 += chunk)
+	{
+		int32_t nChunk = MIN(chunk, n - idx0);
+		for (int32_t idx = 0; idx < nChunk; idx++)
+		{/* the scale is even in the radius, a tiny radius stands for 0 */
+			bufR[idx] = sqrtf(MAX(k[idx0 + idx], 1e-8F));
+		}
+		if (FISHEYE_TO_PINHOLE == dir)
+		{/* ray (r, 0, 1) -> u = mOut[0] * scale * r */
+			for (int32_t idx = 0; idx < nChunk; idx++)
+			{
+				bufA[idx] = bufR[idx];
+				bufB[idx] = 0.0F;
+				bufC[idx] = 1.0F;
+			}
+			modelProject(model, type, bufA, bufB, bufC, bufU, bufV, nChunk);
+			for (int32_t idx = 0; idx < nChunk; idx++)
+			{
+				scale[idx0 + idx] = (bufU[idx] - radial->cOut[0]) / (radial->mOut[0] * bufR[idx]);
+			}
+		}
+		else
+		{/* pixel at in = (r, 0) -> ray -> x / z = scale * r */
+			for (int32_t idx = 0; idx < nChunk; idx++)
+			{
+				bufU[idx] = float32_t(radial->cIn[0] + A[0] * bufR[idx]);
+				bufV[idx] = float32_t(radial->cIn[1] + A[2] * bufR[idx]);
+			}
+			modelUnproject(model, type, bufU, bufV, bufA, bufB, bufC, nChunk);
+			for (int32_t idx = 0; idx < nChunk; idx++)
+			{
+				/* rays at or behind the pinhole image plane have no source */
+				scale[idx0 + idx] = (bufC[idx] > 1e-6F) ? bufA[idx] / (bufC[idx] * bufR[idx]) : -FLT_MAX;
+			}
+		}
+	}
+	return;
+}
+
+/**
+* @brief build a radial remap between a camera model and a virtual pinhole camera
+* @param radial [out] radial remap, released by releaseRemapRadial
+* @param model  [in]  camera model, CamInt or CamIntKannalaBrandt
+* @param type   [in]  camera model type, align with [CameraModel]
+* @param pin    [in]  virtual pinhole camera
+* @param dir    [in]  remap direction
+* @return success flag
+*/
+CFlags buildRemapRadial(RemapRadial* radial, void* model, int32_t type, PinholeInt* pin, RemapDirection dir)
+{
+	int32_t modelW, modelH;
+	float32_t modelCu, modelCv;
+	if ((NULL == model) || (CTRUE != modelGeometry(model, type, &modelW, &modelH, &modelCu, &modelCv)))
+	{
+		return CFALSE;
+	}
+	if ((UNIVERSAL == type) && ((CamInt*)model)->rLut.empty() && (CTRUE != buildRadiusLut((CamInt*)model)))
+	{
+		return CFALSE;
+	}
+
+	releaseRemapRadial(radial);
+	float64_t A[4];
+	modelAffine(model, type, A);
+	if (FISHEYE_TO_PINHOLE == dir)
+	{
+		radial->width = pin->imgW;
+		radial->height = pin->imgH;
+		radial->srcW = modelW;
+		radial->srcH = modelH;
+		radial->cIn[0] = pin->cu;
+		radial->cIn[1] = pin->cv;
+		radial->mIn[0] = 1.0F / pin->fu;
+		radial->mIn[3] = 1.0F / pin->fv;
+		radial->cOut[0] = modelCu;
+		radial->cOut[1] = modelCv;
+		for (int32_t idx = 0; idx < 4; idx++)
+		{
+			radial->mOut[idx] = float32_t(A[idx]);
+		}
+	}
+	else
+	{
+		float64_t det = A[0] * A[3] - A[1] * A[2];
+		radial->width = modelW;
+		radial->height = modelH;
+		radial->srcW = pin->imgW;
+		radial->srcH = pin->imgH;
+		radial->cIn[0] = modelCu;
+		radial->cIn[1] = modelCv;
+		radial->mIn[0] = float32_t(A[3] / det);
+		radial->mIn[1] = float32_t(-A[1] / det);
+		radial->mIn[2] = float32_t(-A[2] / det);
+		radial->mIn[3] = float32_t(A[0] / det);
+		radial->cOut[0] = pin->cu;
+		radial->cOut[1] = pin->cv;
+		radial->mOut[0] = pin->fu;
+		radial->mOut[3] = pin->fv;
+	}
+	if ((radial->width <= 0) || (radial->height <= 0))
+	{
+		CLOG_E("Invalid remap size %d x %d\n", radial->width, radial->height);
+		return CFALSE;
+	}
+
+	/* |in|^2 is convex, its max over the output image is at a corner, same for the source radius */
+	float32_t kMax = 1e-6F;
+	float32_t srcRadius = 0.0F;
+	for (int32_t corner = 0; corner < 4; corner++)
+	{
+		float32_t dx = ((corner & 1) ? radial->width - 1 : 0) - radial->cIn[0];
+		float32_t dy = ((corner & 2) ? radial->height - 1 : 0) - radial->cIn[1];
+		float32_t in0 = radial->mIn[0] * dx + radial->mIn[1] * dy;
+		float32_t in1 = radial->mIn[2] * dx + radial->mIn[3] * dy;
+		kMax = MAX(kMax, in0*in0 + in1*in1);
+		dx = ((corner & 1) ? radial->srcW - 1 : 0) - radial->cOut[0];
+		dy = ((corner & 2) ? radial->srcH - 1 : 0) - radial->cOut[1];
+		srcRadius = MAX(srcRadius, sqrtf(dx*dx + dy*dy));
+	}
+	/* smallest and largest stretch of mOut, singular values of the 2x2 */
+	float32_t sumSq = radial->mOut[0] * radial->mOut[0] + radial->mOut[1] * radial->mOut[1] +
+		radial->mOut[2] * radial->mOut[2] + radial->mOut[3] * radial->mOut[3];
+	float32_t det = fabsf(radial->mOut[0] * radial->mOut[3] - radial->mOut[1] * radial->mOut[2]);
+	float32_t root = sqrtf(MAX(sumSq*sumSq - 4.0F*det*det, 0.0F));
+	float32_t gainMin = sqrtf(0.5F*(sumSq - root));
+	float32_t gainMax = sqrtf(0.5F*(sumSq + root));
+
+	/* stop the lut where the source leaves the source image for good, pixels beyond
+	* clamp to the last entry and still land outside or have no source */
+	const int32_t nScan = 4096;
+	std::vector<float32_t> k(nScan + 1), lut(nScan + 1);
+	for (int32_t idx = 0; idx <= nScan; idx++)
+	{
+		k[idx] = kMax*idx / nScan;
+	}
+	radialScale(radial, model, type, dir, k.data(), lut.data(), nScan + 1);
+	for (int32_t idx = 1; idx <= nScan; idx++)
+	{
+		if ((lut[idx] < 0.0F) || (gainMin*lut[idx] * sqrtf(k[idx]) > srcRadius))
+		{
+			kMax = k[idx];
+			break;
+		}
+	}
+
+	/* double the lut until the interval midpoints are within tolerance, or until
+	* doubling stops paying off, linear interpolation error drops 4x per doubling
+	* so a smaller drop means the float noise of the model itself is reached */
+	float32_t maxErr = FLT_MAX;
+	float32_t lastErr = FLT_MAX;
+	int32_t lutSize = 65;
+	while (true)
+	{
+		lastErr = maxErr;
+		float32_t kStep = kMax / (lutSize - 1);
+		k.resize(2 * lutSize - 1);
+		for (int32_t idx = 0; idx < 2 * lutSize - 1; idx++)
+		{
+			k[idx] = 0.5F*kStep*idx;
+		}
+		lut.resize(2 * lutSize - 1);
+		radialScale(radial, model, type, dir, k.data(), lut.data(), 2 * lutSize - 1);
+		/* pixels are float, the scale at radius ~0 is (u - cu) / r of tiny numbers, extrapolate it */
+		lut[0] = 2.0F*lut[1] - lut[2];
+		maxErr = 0.0F;
+		for (int32_t idx = 1; idx < 2 * lutSize - 1; idx += 2)
+		{
+			if ((lut[idx - 1] >= 0.0F) && (lut[idx] >= 0.0F) && (lut[idx + 1] >= 0.0F) &&
+				(gainMin*lut[idx] * sqrtf(k[idx]) <= srcRadius))
+			{
+				float32_t err = fabsf(0.5F*(lut[idx - 1] + lut[idx + 1]) - lut[idx])*gainMax*sqrtf(k[idx]);
+				maxErr = MAX(maxErr, err);
+			}
+		}
+		if ((maxErr <= REMAP_RADIAL_TOL) || (maxErr > 0.5F*lastErr))
+		{
+			break;
+		}
+		if (2 * (lutSize - 1) > REMAP_RADIAL_MAX)
+		{
+			CLOG_I(0, "Radial remap lut error %f pixel above tolerance\n", maxErr);
+			break;
+		}
+		lutSize = 2 * (lutSize - 1) + 1;
+	}
+	radial->lutSize = lutSize;
+	radial->kInvStep = (lutSize - 1) / kMax;
+	radial->lut = new float32_t[lutSize];
+	for (int32_t idx = 0; idx < lutSize; idx++)
+	{
+		radial->lut[idx] = lut[2 * idx];
+	}
+	CLOG_I(2, "Radial remap lut %d entries, interpolation error %f pixel\n", lutSize, maxErr);
+	return CTRUE;
+}
+
+/**
+* @brief source coordinates of a row of output pixels x0 + idx * xStep
+* @param radial [in]  radial remap
+* @param x0     [in]  first output u
+* @param xStep  [in]  output u step
+* @param y      [in]  output v
+* @param n      [in]  number of pixels
+* @param u      [out] source u, REMAP_INVALID without source
+* @param v      [out] source v, REMAP_INVALID without source
+* @return void return
+*/
+static void radialRow(const RemapRadial* radial, float32_t x0, float32_t xStep, float32_t y, int32_t n,
+	float32_t* u, float32_t* v)
+{
+	float32_t lane[SIMD_WIDTH];
+	for (int32_t idx = 0; idx < SIMD_WIDTH; idx++)
+	{
+		lane[idx] = float32_t(idx);
+	}
+	float32_t dy = y - radial->cIn[1];
+	vf32 vLane = vLoad(lane);
+	vf32 inY0 = vSet1(radial->mIn[1] * dy);
+	vf32 inY1 = vSet1(radial->mIn[3] * dy);
+	for (int32_t idx = 0; idx < n; idx += SIMD_WIDTH)
+	{
+		vf32 x = vFmadd(vAdd(vLane, vSet1(float32_t(idx))), vSet1(xStep), vSet1(x0));
+		vf32 dx = vSub(x, vSet1(radial->cIn[0]));
+		vf32 in0 = vFmadd(vSet1(radial->mIn[0]), dx, inY0);
+		vf32 in1 = vFmadd(vSet1(radial->mIn[2]), dx, inY1);
+		vf32 k = vFmadd(in0, in0, vMul(in1, in1));
+		vf32 pos = vMin(vMul(k, vSet1(radial->kInvStep)), vSet1(float32_t(radial->lutSize - 1)));
+		vi32 posIdx = viMin(vCvtTrunc(pos), viSet1(radial->lutSize - 2));
+		vf32 lo = vGather(radial->lut, posIdx);
+		vf32 hi = vGather(radial->lut + 1, posIdx);
+		vf32 scale = vFmadd(vSub(pos, vCvtI2F(posIdx)), vSub(hi, lo), lo);
+		vm32 valid = vCmpGe(scale, vSet1(0.0F));
+		in0 = vMul(in0, scale);
+		in1 = vMul(in1, scale);
+		vf32 su = vFmadd(vSet1(radial->mOut[0]), in0, vFmadd(vSet1(radial->mOut[1]), in1, vSet1(radial->cOut[0])));
+		vf32 sv = vFmadd(vSet1(radial->mOut[2]), in0, vFmadd(vSet1(radial->mOut[3]), in1, vSet1(radial->cOut[1])));
+		su = vSelect(valid, su, vSet1(REMAP_INVALID));
+		sv = vSelect(valid, sv, vSet1(REMAP_INVALID));
+		if (idx + SIMD_WIDTH <= n)
+		{
+			vStore(u + idx, su);
+			vStore(v + idx, sv);
+		}
+		else
+		{
+			float32_t bufU[SIMD_WIDTH], bufV[SIMD_WIDTH];
+			vStore(bufU, su);
+			vStore(bufV, sv);
+			memcpy(u + idx, bufU, sizeof(float32_t)*(n - idx));
+			memcpy(v + idx, bufV, sizeof(float32_t)*(n - idx));
+		}
+	}
+	return;
+}
+
+/**
+* @brief expand a radial remap to full remap maps
+* @param map    [out] remap map, released by releaseRemap
+* @param radial [in]  radial remap
+* @return success flag
+*/
+CFlags expandRemapRadial(RemapMap* map, RemapRadial* radial)
+{
+	if (NULL == radial->lut)
+	{
+		CLOG_E("Radial remap is empty\n");
+		return CFALSE;
+	}
+	releaseRemap(map);
+	map->width = radial->width;
+	map->height = radial->height;
+	map->mapU = new float32_t[(size_t)map->width*map->height];
+	map->mapV = new float32_t[(size_t)map->width*map->height];
+	for (int32_t row = 0; row < map->height; row++)
+	{
+		radialRow(radial, 0.0F, 1.0F, float32_t(row), map->width,
+			map->mapU + (size_t)row*map->width, map->mapV + (size_t)row*map->width);
+	}
+	return CTRUE;
+}
+
+/**
+* @brief save radial remap as binary file
+* @param path   [in] save path
+* @param radial [in] radial remap
+* @return success flag
+*/
+CFlags saveRemapRadial(const char* path, RemapRadial* radial)
+{
+	FILE* file2Save = fopen(path, "wb");
+	if (NULL == file2Save)
+	{
+		CLOG_E("Could not open %s\n", path);
+		return CFALSE;
+	}
+	char flag[12] = "REMAP_RLUT";
+	fwrite(flag, sizeof(flag), 1, file2Save);
+	fwrite(&radial->width, sizeof(int32_t), 1, file2Save);
+	fwrite(&radial->height, sizeof(int32_t), 1, file2Save);
+	fwrite(&radial->srcW, sizeof(int32_t), 1, file2Save);
+	fwrite(&radial->srcH, sizeof(int32_t), 1, file2Save);
+	fwrite(radial->cIn, sizeof(float32_t), 2, file2Save);
+	fwrite(radial->mIn, sizeof(float32_t), 4, file2Save);
+	fwrite(radial->cOut, sizeof(float32_t), 2, file2Save);
+	fwrite(radial->mOut, sizeof(float32_t), 4, file2Save);
+	fwrite(&radial->kInvStep, sizeof(float32_t), 1, file2Save);
+	fwrite(&radial->lutSize, sizeof(int32_t), 1, file2Save);
+	fwrite(radial->lut, sizeof(float32_t), radial->lutSize, file2Save);
+	fclose(file2Save);
+	return CTRUE;
+}
+
+/**
+* @brief apply a radial remap to an image
+* @param dst    [out] output image, size of the remap, same format as src
+* @param src    [in]  source image, size of the remap source
+* @param radial [in]  radial remap
+* @param pool   [in]  thread pool to run tiles on, NULL runs on the calling thread
+* @return success flag
+*/
+CFlags remapImageRadial(ImageU8* dst, const ImageU8* src, RemapRadial* radial, ThreadPool* pool)
+{
+	if ((NULL == radial->lut) || (src->format != dst->format) ||
+		(dst->width != radial->width) || (dst->height != radial->height) ||
+		(src->width != radial->srcW) || (src->height != radial->srcH))
+	{
+		CLOG_E("Image and radial remap do not match\n");
+		return CFALSE;
+	}
+	if ((src->width > 32767) || (src->height > 32767) || ((IMAGE_NV12 == src->format) &&
+		((src->width % 4) || (src->height % 4) || (dst->width % 2) || (dst->height % 2))))
+	{
+		CLOG_E("Unsupported radial remap size\n");
+		return CFALSE;
+	}
+	int32_t srcW = src->width;
+	int32_t srcH = src->height;
+	auto luma = [&](int32_t row, int32_t x0, int32_t nCol, int32_t* xyBuf, uint16_t* fracBuf,
+		const int32_t** xy, const uint16_t** frac)
+	{
+		float32_t u[REMAP_TILE_W], v[REMAP_TILE_W];
+		radialRow(radial, float32_t(x0), 1.0F, float32_t(row), nCol, u, v);
+		toFixedRow(u, v, nCol, srcW, srcH, xyBuf, fracBuf);
+		*xy = xyBuf;
+		*frac = fracBuf;
+	};
+	/* chroma sample (i, j) sits at luma (2i + 0.5, 2j + 0.5), see convertRemapFixed */
+	auto chroma = [&](int32_t row, int32_t x0, int32_t nCol, int32_t* xyBuf, uint16_t* fracBuf,
+		const int32_t** xy, const uint16_t** frac)
+	{
+		float32_t u[REMAP_TILE_W], v[REMAP_TILE_W];
+		radialRow(radial, 2.0F*x0 + 0.5F, 2.0F, 2.0F*row + 0.5F, nCol, u, v);
+		for (int32_t idx = 0; idx < nCol; idx++)
+		{
+			if ((u[idx] >= 0.0F) && (v[idx] >= 0.0F) && (u[idx] <= srcW - 1) && (v[idx] <= srcH - 1))
+			{
+				u[idx] = MIN(MAX(0.5F*(u[idx] - 0.5F), 0.0F), float32_t(srcW / 2 - 1));
+				v[idx] = MIN(MAX(0.5F*(v[idx] - 0.5F), 0.0F), float32_t(srcH / 2 - 1));
+			}
+			else
+			{
+				u[idx] = REMAP_INVALID;
+			}
+		}
+		toFixedRow(u, v, nCol, srcW / 2, srcH / 2, xyBuf, fracBuf);
+		*xy = xyBuf;
+		*frac = fracBuf;
+	};
+	switch (src->format)
+	{
+	case IMAGE_GRAY:
+		remapPlane<1>(dst->data, dst->stride, src->data, src->stride, srcW, srcH, dst->width, dst->height, luma, pool);
+		break;
+	case IMAGE_RGB:
+		remapPlane<3>(dst->data, dst->stride, src->data, src->stride, srcW, srcH, dst->width, dst->height, luma, pool);
+		break;
+	case IMAGE_NV12:
+		remapPlane<1>(dst->data, dst->stride, src->data, src->stride, srcW, srcH, dst->width, dst->height, luma, pool);
+		remapPlane<2>(dst->dataUV, dst->stride, src->dataUV, src->stride, srcW / 2, srcH / 2,
+			dst->width / 2, dst->height / 2, chroma, pool);
+		break;
+	default:
+		CLOG_E("Unsupported image format\n");
+		return CFALSE;
+	}
+	return CTRUE;
+}
+
+/**
+* @brief release radial remap
+* @param radial [in] radial remap
+* @return void return
+*/
+void releaseRemapRadial(RemapRadial* radial)
+{
+	delete[] radial->lut;
+	*radial = RemapRadial();
+	return;
+}
@@ -0,0 +1,108 @@
+/**
+* Copyright: Yihui Yu. All rights reserved.
+*
+* Author: Yihui Yu
+* Date: 2020 - 02 - 06
+* Description: fixed size thread pool for data parallel stages
+*/
+#include "ThreadPool.h"
+
+/**
+* Constructor, start worker threads
+* @param nThreads [in] number of threads, including the calling thread,
+*                      0 means one per hardware thread
+*/
+ThreadPool::ThreadPool(int32_t nThreads)
+	: job(NULL), nextTask(0), nTasks(0), nBusy(0), generation(0), stop(false)
+{
+	if (nThreads <= 0)
+	{
+		nThreads = MAX(int32_t(std::thread::hardware_concurrency()), 1);
+	}
+	for (int32_t idx = 0; idx < nThreads - 1; idx++)
+	{
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+	return;
+}
+
+/**
+* DeConstructor, stop and join worker threads
+*/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	cvStart.notify_all();
+	for (size_t idx = 0; idx < workers.size(); idx++)
+	{
+		workers[idx].join();
+	}
+	return;
+}
+
+/**
+* Run task(0) ... task(nTasks - 1) on all threads and wait for them
+* @param nTasks [in] number of tasks
+* @param task   [in] task body, called with the task index
+* @return void return
+*/
+void ThreadPool::parallelFor(int32_t nTasks, const std::function<void(int32_t)>& task)
+{
+	if (nTasks <= 0)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> callLock(callMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->job = &task;
+		this->nTasks = nTasks;
+		this->nextTask = 0;
+		this->nBusy = int32_t(workers.size());
+		this->generation++;
+	}
+	cvStart.notify_all();
+	/* the calling thread works too */
+	runTasks();
+	std::unique_lock<std::mutex> lock(mutex);
+	cvDone.wait(lock, [this] { return 0 == nBusy; });
+	this->job = NULL;
+	return;
+}
+
+void ThreadPool::workerLoop()
+{
+	uint32_t seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cvStart.wait(lock, [this, seen] { return stop || (generation != seen); });
+			if (stop)
+			{
+				return;
+			}
+			seen = generation;
+		}
+		runTasks();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			nBusy--;
+		}
+		cvDone.notify_one();
+	}
+}
+
+void ThreadPool::runTasks()
+{
+	int32_t taskIdx = nextTask.fetch_add(1);
+	while (taskIdx < nTasks)
+	{
+		(*job)(taskIdx);
+		taskIdx = nextTask.fetch_add(1);
+	}
+	return;
+}
@@ -1,4 +1,60 @@
 #include "common.h"
+#include "simd.h"
+#include <algorithm>
+#include <cfloat>
+
+/**
+* @brief segment of a non-uniform curve holding an angle,
+*        dAngle[idx] <= angle < dAngle[idx + 1], clamped to the curve.
+*        starts from the angle guide, a few steps at most, and falls back
+*        to a binary search when the guide is not built
+* @param cam   [in] camera model, with dAngle
+* @param angle [in] target angle, in degree, below the last angle
+* @return segment idx, in [0, dCurveSize - 2]
+*/
+static int32_t findAngleSegment(const CamInt* cam, float32_t angle)
+{
+	const float32_t* pAngle = cam->dAngle.data();
+	if (cam->aGuide.empty())
+	{
+		return int32_t(std::upper_bound(pAngle + 1, pAngle + cam->dCurveSize - 1, angle) - pAngle) - 1;
+	}
+	int32_t bin = MIN(int32_t(MAX(angle / cam->aStep, 0.0F)), int32_t(cam->aGuide.size()) - 1);
+	int32_t idx = cam->aGuide[bin];
+	while ((idx < cam->dCurveSize - 2) && (pAngle[idx + 1] <= angle))
+	{
+		idx++;
+	}
+	return idx;
+}
+
+/**
+* @brief drop the angles of a disortion curve when they are the uniform
+*        grid idx*dStep, so the curve is kept as radius only. call after
+*        dAngle and dRadius are loaded
+* @param cam [in/out] camera model
+* @return void return
+*/
+void dropUniformAngles(CamInt* cam)
+{
+	if (cam->dAngle.empty())
+	{
+		return;
+	}
+	for (int32_t idx = 0; idx < cam->dCurveSize; idx++)
+	{
+		/* a step fraction, plus float and 6 decimal text rounding of large angles */
+		float64_t angle = cam->dAngle[idx];
+		float64_t tol = 0.01*cam->dStep + 4.0*FLT_EPSILON*fabs(angle) + 1e-6;
+		if (fabs(angle - float64_t(idx)*cam->dStep) > tol)
+		{
+			return;
+		}
+	}
+	cam->dAngle.reset();
+	cam->aGuide.clear();
+	return;
+}
 
 /**
 * @brief find R(radius) from A (angle) in LUT
@@ -9,27 +65,51 @@
 float32_t findRfromA(float32_t theta, CamInt* cam)
 {
 	float32_t radius = 0.0F;
-	float32_t* pLut = cam->dCurve;
-	if (theta >= 0 && theta < (cam->dCurveSize-1)*cam->dStep*DEG2RAD)
-	{
-		/* Transfer theta to index */
-		int32_t idxB = int(theta / (cam->dStep*DEG2RAD)) - 1;
-
-		if (idxB < cam->dCurveSize - 1)
+	const float32_t* pRadius = cam->dRadius.data();
+	if (!cam->sCoef.empty())
+	{/* spline, the segment is known from the angle */
+		float32_t pos = theta / cam->sStep;
+		if (theta < 0)
 		{
-			int32_t idxU = idxB + 1;
-
-			float32_t rB = *(pLut + idxB*2 + 1);
-			float32_t rU = *(pLut + idxU*2 + 1);
-			float32_t thetaB = (idxB + 1)*(cam->dStep*DEG2RAD);
-			float32_t thetaU = (idxU + 1)*(cam->dStep*DEG2RAD);
-			radius = ((theta - thetaB)*rU + (thetaU - theta)*rB) / (cam->dStep*DEG2RAD);
+			return 0.0F;
 		}
-		else
+		if (pos >= cam->sCurveSize - 1)
 		{
-			float32_t rB = *(pLut + idxB*2 + 1);
-			radius = rB;
+			return pRadius[cam->dCurveSize - 1];
 		}
+		int32_t idx = int32_t(pos);
+		float32_t u = pos - idx;
+		const float32_t* c = cam->sCoef.data() + 4*idx;
+		return c[0] + u*(c[1] + u*(c[2] + u*c[3]));
+	}
+	if (!cam->dAngle.empty())
+	{/* non-uniform curve, search the segment */
+		float32_t angle = theta*float32_t(1.0 / DEG2RAD);
+		if (theta < 0)
+		{
+			return 0.0F;
+		}
+		if (angle >= cam->dAngle[cam->dCurveSize - 1])
+		{
+			return pRadius[cam->dCurveSize - 1];
+		}
+		int32_t idx = findAngleSegment(cam, angle);
+		float32_t aB = cam->dAngle[idx];
+		float32_t frac = MAX((angle - aB) / (cam->dAngle[idx + 1] - aB), 0.0F);
+		return pRadius[idx] + frac*(pRadius[idx + 1] - pRadius[idx]);
+	}
+	float32_t stepRad = float32_t(cam->dStep*DEG2RAD);
+	if (theta >= 0 && theta < (cam->dCurveSize-1)*stepRad)
+	{
+		/* Transfer theta to index, curve point idx is at angle idx*dStep */
+		float32_t pos = theta / stepRad;
+		int32_t idxB = MIN(int32_t(pos), cam->dCurveSize - 2);
+		int32_t idxU = idxB + 1;
+
+		float32_t rB = pRadius[idxB];
+		float32_t rU = pRadius[idxU];
+		/* interpolate on the fraction, differences of close angles lose precision in float */
+		radius = rB + (pos - idxB)*(rU - rB);
 	}
 	else if (theta<0)
 	{
@@ -37,11 +117,38 @@ float32_t findRfromA(float32_t theta, CamInt* cam)
 	}
 	else
 	{
-		radius = *(pLut + (cam->dCurveSize - 1)*2 + 1);
+		radius = pRadius[cam->dCurveSize - 1];
 	}
 	return radius;
 }
 
+/**
+* @brief find dR/dA, the slope of the disortion curve, for jacobians,
+*        analytic on the spline, the segment slope otherwise
+* @param theta [in]  target theta, in rad
+* @param cam   [cam] camera model
+* @return slope, in mm per rad, 0 outside of the curve
+*/
+float32_t findDRfromA(float32_t theta, CamInt* cam)
+{
+	float32_t angle = theta*float32_t(1.0 / DEG2RAD);
+	if ((theta < 0) || (angle >= curveAngle(cam, cam->dCurveSize - 1)))
+	{
+		return 0.0F;
+	}
+	if (!cam->sCoef.empty())
+	{
+		float32_t pos = theta / cam->sStep;
+		int32_t idx = MIN(int32_t(pos), cam->sCurveSize - 2);
+		float32_t u = pos - idx;
+		const float32_t* c = cam->sCoef.data() + 4*idx;
+		return (c[1] + u*(2.0F*c[2] + u*3.0F*c[3])) / cam->sStep;
+	}
+	int32_t idx = cam->dAngle.empty() ? MIN(int32_t(angle / cam->dStep), cam->dCurveSize - 2) : findAngleSegment(cam, angle);
+	float32_t da = curveAngle(cam, idx + 1) - curveAngle(cam, idx);
+	return float32_t((cam->dRadius[idx + 1] - cam->dRadius[idx]) / (da*DEG2RAD));
+}
+
 /**
 * @brief find A (angle) from R(radius) in LUT
 * @param radius [in]  target radius
@@ -50,36 +157,46 @@ float32_t findRfromA(float32_t theta, CamInt* cam)
 */
 float32_t findAfromR(float32_t radius, CamInt* cam)
 {
+	if (!cam->rLut.empty())
+	{/* constant time lookup in the inverse curve */
+		float32_t pos = MIN(MAX(radius / cam->rStep, 0.0F), float32_t(cam->rLutSize - 1));
+		int32_t idx = MIN(int32_t(pos), cam->rLutSize - 2);
+		float32_t frac = pos - idx;
+		return cam->rLut[idx] + frac*(cam->rLut[idx + 1] - cam->rLut[idx]);
+	}
+
 	float32_t theta = 0.0F;
-	float32_t* pLut = cam->dCurve;
+	const float32_t* pRadius = cam->dRadius.data();
+	float32_t stepRad = float32_t(cam->dStep*DEG2RAD);
 	if (radius < 0)
 	{
 		theta = 0.0F;
 	}
-	else if (radius > *(pLut + (cam->dCurveSize - 1))*2 + 1)
+	else if (radius >= pRadius[cam->dCurveSize - 1])
 	{
-		theta = (float32_t)((cam->dCurveSize - 1)*cam->dStep*DEG2RAD);
+		theta = cam->dAngle.empty() ? (float32_t)((cam->dCurveSize - 1)*stepRad)
+			: float32_t(cam->dAngle[cam->dCurveSize - 1]*DEG2RAD);
 	}
 	else
 	{
 		//the following is the tranditional half size searching.
 		CFlags flagFind = CFALSE;
 		int32_t idxTop = 0;
-		int32_t idxBottom = cam->dCurveSize-1;
+		int32_t idxBottom = cam->dCurveSize-2;
 		int32_t idxMid = 0;
 		int32_t idxFind = 0;
 		while ((CFALSE == flagFind) && (idxTop <= idxBottom))
 		{
 
 			idxMid = (idxTop + idxBottom) / 2;
-			if (radius >= *(pLut + idxMid*2 + 1) && radius < *(pLut + (idxMid + 1)*2 + 1))
+			if (radius >= pRadius[idxMid] && radius < pRadius[idxMid + 1])
 			{
 				idxFind = idxMid;
 				flagFind = CTRUE;
 			}
 			else
 			{
-				if (radius < *(pLut + (idxMid + 1) * 2 + 1))
+				if (radius < pRadius[idxMid + 1])
 				{
 					idxBottom = idxMid - 1;
 				}
@@ -90,10 +207,610 @@ float32_t findAfromR(float32_t radius, CamInt* cam)
 			}
 		}
 		//find, interpolate
-		float32_t thetaB = (float32_t)((idxFind + 1)*cam->dStep*DEG2RAD);
-		float32_t thetaU = (float32_t)((idxFind + 2)*cam->dStep*DEG2RAD);
-		theta = ((radius - *(pLut + idxFind * 2 + 1))*thetaU + (*(pLut + (idxFind + 1) * 2 + 1) - radius)*thetaB) / 
-			(*(pLut + (idxFind + 1) * 2 + 1) - *(pLut + idxFind * 2 + 1));
+		float32_t rB = pRadius[idxFind];
+		float32_t rU = pRadius[idxFind + 1];
+		float32_t frac = (radius - rB) / (rU - rB);
+		if (cam->dAngle.empty())
+		{
+			theta = (idxFind + frac)*stepRad;
+		}
+		else
+		{
+			float32_t aB = cam->dAngle[idxFind];
+			theta = float32_t((aB + frac*(cam->dAngle[idxFind + 1] - aB))*DEG2RAD);
+		}
 	}
 	return theta;
-}
\ No newline at end of file
+}
+
+/**
+* @brief find R(radius) from A (angle) for one SIMD vector, see findRfromA
+*/
+static inline vf32 vFindRfromA(vf32 theta, CamInt* cam)
+{
+	if (!cam->sCoef.empty())
+	{/* spline, gather the 4 coef of each lane, horner on the fraction */
+		vf32 pos = vMul(theta, vSet1(1.0F / cam->sStep));
+		pos = vMin(vMax(pos, vSet1(0.0F)), vSet1(float32_t(cam->sCurveSize - 1)));
+		vi32 idx = viMin(vCvtTrunc(pos), viSet1(cam->sCurveSize - 2));
+		vf32 u = vSub(pos, vCvtI2F(idx));
+		vi32 ofs = viSll(idx, 2);
+		const float32_t* c = cam->sCoef.data();
+		vf32 r = vGather(c + 3, ofs);
+		r = vFmadd(r, u, vGather(c + 2, ofs));
+		r = vFmadd(r, u, vGather(c + 1, ofs));
+		return vFmadd(r, u, vGather(c, ofs));
+	}
+	if (!cam->dAngle.empty())
+	{/* non-uniform curve, lane by lane */
+		float32_t lane[SIMD_WIDTH];
+		vStore(lane, theta);
+		for (int32_t idx = 0; idx < SIMD_WIDTH; idx++)
+		{
+			lane[idx] = findRfromA(lane[idx], cam);
+		}
+		return vLoad(lane);
+	}
+	vf32 pos = vMul(theta, vSet1(float32_t(1.0 / (cam->dStep*DEG2RAD))));
+	pos = vMin(vMax(pos, vSet1(0.0F)), vSet1(float32_t(cam->dCurveSize - 1)));
+	vi32 idx = viMin(vCvtTrunc(pos), viSet1(cam->dCurveSize - 2));
+	vf32 frac = vSub(pos, vCvtI2F(idx));
+	vf32 rB = vGather(cam->dRadius.data(), idx);
+	vf32 rU = vGather(cam->dRadius.data(), viAdd(idx, viSet1(1)));
+	return vFmadd(frac, vSub(rU, rB), rB);
+}
+
+/**
+* @brief find A (angle) from R(radius) for one SIMD vector with the inverse curve
+*/
+static inline vf32 vFindAfromR(vf32 radius, CamInt* cam)
+{
+	vf32 pos = vMul(radius, vSet1(1.0F / cam->rStep));
+	pos = vMin(vMax(pos, vSet1(0.0F)), vSet1(float32_t(cam->rLutSize - 1)));
+	vi32 idx = viMin(vCvtTrunc(pos), viSet1(cam->rLutSize - 2));
+	vf32 frac = vSub(pos, vCvtI2F(idx));
+	vf32 thetaB = vGather(cam->rLut.data(), idx);
+	vf32 thetaU = vGather(cam->rLut.data(), viAdd(idx, viSet1(1)));
+	return vFmadd(frac, vSub(thetaU, thetaB), thetaB);
+}
+
+/**
+* @brief find A (angle) from R(radius) for a batch of radius,
+*        uses the inverse curve, SIMD gather + lerp
+* @param radius [in]  target radius
+* @param theta  [out] found angle
+* @param n      [in]  number of radius
+* @param cam    [cam] camera model
+* @return void return
+*/
+void findAfromRBatch(const float32_t* radius, float32_t* theta, int32_t n, CamInt* cam)
+{
+	int32_t idx = 0;
+	if (!cam->rLut.empty())
+	{
+		for (; idx + SIMD_WIDTH <= n; idx += SIMD_WIDTH)
+		{
+			vStore(theta + idx, vFindAfromR(vLoad(radius + idx), cam));
+		}
+	}
+	for (; idx < n; idx++)
+	{
+		theta[idx] = findAfromR(radius[idx], cam);
+	}
+	return;
+}
+
+/**
+* @brief pixels per mm of the universal model, the FOV angle at the
+*        optic center reaches the image border, same as fitKannalaBrandt
+* @param cam [in]  camera model
+* @param mu  [out] pixels per mm, u
+* @param mv  [out] pixels per mm, v
+* @return void return
+*/
+void universalPixelScale(CamInt* cam, float32_t* mu, float32_t* mv)
+{
+	*mu = cam->cu / findRfromA(cam->fu, cam);
+	*mv = cam->cv / findRfromA(cam->fv, cam);
+	return;
+}
+
+/**
+* @brief project one SIMD vector of points, see projectUniversal
+*/
+static inline void projectUniversalKernel(CamInt* cam, const vf32* vIntr, vf32 x, vf32 y, vf32 z, vf32* u, vf32* v)
+{
+	vf32 rxy = vSqrt(vFmadd(x, x, vMul(y, y)));
+	vf32 r = vFindRfromA(vAtan2Pos(rxy, z), cam);
+	vm32 offAxis = vCmpGt(rxy, vSet1(1e-30F));
+	vf32 scale = vSelect(offAxis, vDiv(r, vMax(rxy, vSet1(1e-30F))), vSet1(0.0F));
+	vf32 xs = vMul(vMul(vIntr[2], scale), x);
+	vf32 ys = vMul(vMul(vIntr[3], scale), y);
+	/* skew: u = cu + c*xs + d*ys, v = cv + e*xs + ys */
+	*u = vFmadd(vIntr[4], xs, vFmadd(vIntr[5], ys, vIntr[0]));
+	*v = vFmadd(vIntr[6], xs, vAdd(ys, vIntr[1]));
+	return;
+}
+
+/**
+* @brief unproject one SIMD vector of pixels, see unprojectUniversal
+*/
+static inline void unprojectUniversalKernel(CamInt* cam, const vf32* vIntr, vf32 u, vf32 v, vf32* x, vf32* y, vf32* z)
+{
+	vf32 du = vSub(u, vIntr[0]);
+	vf32 dv = vSub(v, vIntr[1]);
+	/* invert skew, vIntr[7] is 1/(c - d*e) */
+	vf32 xs = vMul(vSub(du, vMul(vIntr[5], dv)), vIntr[7]);
+	vf32 ys = vMul(vSub(vMul(vIntr[4], dv), vMul(vIntr[6], du)), vIntr[7]);
+	vf32 mx = vDiv(xs, vIntr[2]);
+	vf32 my = vDiv(ys, vIntr[3]);
+	vf32 r = vSqrt(vFmadd(mx, mx, vMul(my, my)));
+	vf32 sinT, cosT;
+	vSinCosPos(vFindAfromR(r, cam), &sinT, &cosT);
+	vm32 offAxis = vCmpGt(r, vSet1(1e-30F));
+	vf32 scale = vSelect(offAxis, vDiv(sinT, vMax(r, vSet1(1e-30F))), vSet1(0.0F));
+	*x = vMul(scale, mx);
+	*y = vMul(scale, my);
+	*z = vSelect(offAxis, cosT, vSet1(1.0F));
+	return;
+}
+
+/**
+* @brief broadcast universal model intrinsics to SIMD vectors
+* @param cam   [in]  camera model
+* @param vIntr [out] cu, cv, mu, mv, c, d, e, 1/(c - d*e)
+* @return success flag
+*/
+static CFlags broadcastUniversal(CamInt* cam, vf32* vIntr)
+{
+	if (cam->dRadius.empty() || (cam->dCurveSize < 2))
+	{
+		CLOG_E("Disortion curve is empty\n");
+		return CFALSE;
+	}
+	if (cam->rLut.empty() && (CTRUE != buildRadiusLut(cam)))
+	{
+		return CFALSE;
+	}
+	float32_t mu, mv;
+	universalPixelScale(cam, &mu, &mv);
+	float32_t det = cam->c - cam->d*cam->e;
+	if (fabsf(det) < 1e-12F)
+	{
+		CLOG_E("Singular skew parameters\n");
+		return CFALSE;
+	}
+	vIntr[0] = vSet1(cam->cu);
+	vIntr[1] = vSet1(cam->cv);
+	vIntr[2] = vSet1(mu);
+	vIntr[3] = vSet1(mv);
+	vIntr[4] = vSet1(cam->c);
+	vIntr[5] = vSet1(cam->d);
+	vIntr[6] = vSet1(cam->e);
+	vIntr[7] = vSet1(1.0F / det);
+	return CTRUE;
+}
+
+/**
+* @brief project 3D points to pixels with universal model, in batch
+* @param cam [in]  camera model
+* @param x   [in]  point x
+* @param y   [in]  point y
+* @param z   [in]  point z, optic axis
+* @param u   [out] pixel u
+* @param v   [out] pixel v
+* @param n   [in]  number of points
+* @return success flag
+*/
+CFlags projectUniversal(CamInt* cam, const float32_t* x, const float32_t* y, const float32_t* z,
+	float32_t* u, float32_t* v, int32_t n)
+{
+	vf32 vIntr[8];
+	if (CTRUE != broadcastUniversal(cam, vIntr))
+	{
+		return CFALSE;
+	}
+	int32_t idx = 0;
+	for (; idx + SIMD_WIDTH <= n; idx += SIMD_WIDTH)
+	{
+		vf32 vu, vv;
+		projectUniversalKernel(cam, vIntr, vLoad(x + idx), vLoad(y + idx), vLoad(z + idx), &vu, &vv);
+		vStore(u + idx, vu);
+		vStore(v + idx, vv);
+	}
+	if (idx < n)
+	{/* tail, run one padded vector */
+		float32_t bx[SIMD_WIDTH] = { 0 }, by[SIMD_WIDTH] = { 0 }, bz[SIMD_WIDTH] = { 0 };
+		float32_t bu[SIMD_WIDTH], bv[SIMD_WIDTH];
+		int32_t nTail = n - idx;
+		memcpy(bx, x + idx, sizeof(float32_t)*nTail);
+		memcpy(by, y + idx, sizeof(float32_t)*nTail);
+		memcpy(bz, z + idx, sizeof(float32_t)*nTail);
+		vf32 vu, vv;
+		projectUniversalKernel(cam, vIntr, vLoad(bx), vLoad(by), vLoad(bz), &vu, &vv);
+		vStore(bu, vu);
+		vStore(bv, vv);
+		memcpy(u + idx, bu, sizeof(float32_t)*nTail);
+		memcpy(v + idx, bv, sizeof(float32_t)*nTail);
+	}
+	return CTRUE;
+}
+
+/**
+* @brief unproject pixels to unit bearing vectors with universal model, in batch
+* @param cam [in]  camera model
+* @param u   [in]  pixel u
+* @param v   [in]  pixel v
+* @param x   [out] bearing x
+* @param y   [out] bearing y
+* @param z   [out] bearing z, optic axis
+* @param n   [in]  number of pixels
+* @return success flag
+*/
+CFlags unprojectUniversal(CamInt* cam, const float32_t* u, const float32_t* v,
+	float32_t* x, float32_t* y, float32_t* z, int32_t n)
+{
+	vf32 vIntr[8];
+	if (CTRUE != broadcastUniversal(cam, vIntr))
+	{
+		return CFALSE;
+	}
+	int32_t idx = 0;
+	for (; idx + SIMD_WIDTH <= n; idx += SIMD_WIDTH)
+	{
+		vf32 vx, vy, vz;
+		unprojectUniversalKernel(cam, vIntr, vLoad(u + idx), vLoad(v + idx), &vx, &vy, &vz);
+		vStore(x + idx, vx);
+		vStore(y + idx, vy);
+		vStore(z + idx, vz);
+	}
+	if (idx < n)
+	{/* tail, run one padded vector */
+		float32_t bu[SIMD_WIDTH] = { 0 }, bv[SIMD_WIDTH] = { 0 };
+		float32_t bx[SIMD_WIDTH], by[SIMD_WIDTH], bz[SIMD_WIDTH];
+		int32_t nTail = n - idx;
+		memcpy(bu, u + idx, sizeof(float32_t)*nTail);
+		memcpy(bv, v + idx, sizeof(float32_t)*nTail);
+		vf32 vx, vy, vz;
+		unprojectUniversalKernel(cam, vIntr, vLoad(bu), vLoad(bv), &vx, &vy, &vz);
+		vStore(bx, vx);
+		vStore(by, vy);
+		vStore(bz, vz);
+		memcpy(x + idx, bx, sizeof(float32_t)*nTail);
+		memcpy(y + idx, by, sizeof(float32_t)*nTail);
+		memcpy(z + idx, bz, sizeof(float32_t)*nTail);
+	}
+	return CTRUE;
+}
+
+/**
+* @brief build inverse curve, angle at uniform radius steps, so that
+*        findAfromR is a constant time lookup, and the curve spline.
+*        call once per camera model, after the disortion curve is loaded
+* @param cam [in/out] camera model
+* @return success flag
+*/
+CFlags buildRadiusLut(CamInt* cam)
+{
+	if (cam->dRadius.empty() || (cam->dCurveSize < 2))
+	{
+		CLOG_E("Could not build inverse curve, disortion curve is empty\n");
+		return CFALSE;
+	}
+	buildAngleGuide(cam);
+	buildCurveSpline(cam);
+	const float32_t* pRadius = cam->dRadius.data();
+	float32_t stepRad = float32_t(cam->dStep*DEG2RAD);
+	/* only the monotonic part of the curve can be inverted */
+	int32_t idxEnd = 1;
+	while ((idxEnd < cam->dCurveSize) && (pRadius[idxEnd] > pRadius[idxEnd - 1]))
+	{
+		idxEnd++;
+	}
+	idxEnd--;
+	if (0 == idxEnd)
+	{
+		CLOG_E("Could not build inverse curve, disortion curve is not increasing\n");
+		return CFALSE;
+	}
+	float32_t rMax = pRadius[idxEnd];
+
+	/* a resampled curve has few knots, its inverse is still as fine as a default curve */
+	cam->rLutSize = DEFAULT_RLUT_SCALE*MAX(cam->dCurveSize, DEFAULT_CURVE_SIZE);
+	cam->rStep = rMax / (cam->rLutSize - 1);
+	cam->rLut.allocate(cam->rLutSize);
+
+	/* walk both curves once */
+	int32_t idxCurve = 0;
+	for (int32_t idx = 0; idx < cam->rLutSize; idx++)
+	{
+		float32_t radius = idx*cam->rStep;
+		while ((idxCurve < idxEnd - 1) && (pRadius[idxCurve + 1] <= radius))
+		{
+			idxCurve++;
+		}
+		float32_t rB = pRadius[idxCurve];
+		float32_t rU = pRadius[idxCurve + 1];
+		float32_t frac = MIN(MAX((radius - rB) / (rU - rB), 0.0F), 1.0F);
+		if (cam->dAngle.empty())
+		{
+			cam->rLut[idx] = (idxCurve + frac)*stepRad;
+		}
+		else
+		{
+			float32_t aB = cam->dAngle[idxCurve];
+			cam->rLut[idx] = float32_t((aB + frac*(cam->dAngle[idxCurve + 1] - aB))*DEG2RAD);
+		}
+	}
+	float32_t thetaEnd = cam->dAngle.empty() ? idxEnd*stepRad : float32_t(cam->dAngle[idxEnd]*DEG2RAD);
+	if (!cam->sCoef.empty())
+	{/* the chord is off the spline between knots, newton onto the spline */
+		for (int32_t idx = 1; idx < cam->rLutSize - 1; idx++)
+		{
+			float32_t theta = cam->rLut[idx];
+			for (int32_t iter = 0; iter < 2; iter++)
+			{
+				float32_t slope = findDRfromA(theta, cam);
+				if (!(slope > 0.0F))
+				{
+					break;
+				}
+				theta -= (findRfromA(theta, cam) - idx*cam->rStep) / slope;
+				theta = MIN(MAX(theta, 0.0F), thetaEnd);
+			}
+			cam->rLut[idx] = theta;
+		}
+	}
+	cam->rLut[cam->rLutSize - 1] = thetaEnd;
+	return CTRUE;
+}
+
+/**
+* @brief build angle guide of a non-uniform curve, the segment holding
+*        each of a few uniform angle bins, so that findRfromA starts its
+*        knot search next to the target. cleared for a uniform curve
+* @param cam [in/out] camera model
+* @return void return
+*/
+void buildAngleGuide(CamInt* cam)
+{
+	cam->aGuide.clear();
+	cam->aStep = 0.0F;
+	if (cam->dAngle.empty() || (cam->dCurveSize < 2) || !(cam->dAngle[cam->dCurveSize - 1] > 0.0F))
+	{
+		return;
+	}
+	/* bins finer than the knots, so a lookup walks about one knot */
+	int32_t guideSize = DEFAULT_GUIDE_SCALE*cam->dCurveSize;
+	cam->aStep = cam->dAngle[cam->dCurveSize - 1] / guideSize;
+	cam->aGuide.resize(guideSize);
+	int32_t idxCurve = 0;
+	for (int32_t idx = 0; idx < guideSize; idx++)
+	{
+		float32_t angle = idx*cam->aStep;
+		while ((idxCurve < cam->dCurveSize - 2) && (cam->dAngle[idxCurve + 1] <= angle))
+		{
+			idxCurve++;
+		}
+		cam->aGuide[idx] = idxCurve;
+	}
+	return;
+}
+
+/**
+* @brief value and slope at x of the cubic through 4 points
+* @param px    [in]  point x, distinct
+* @param py    [in]  point y
+* @param x     [in]  target x
+* @param value [out] y at x
+* @param slope [out] dy/dx at x
+* @return void return
+*/
+static void lagrangeCubic(const float64_t* px, const float64_t* py, float64_t x, float64_t* value, float64_t* slope)
+{
+	*value = 0.0;
+	*slope = 0.0;
+	for (int32_t idx = 0; idx < 4; idx++)
+	{
+		float64_t denom = 1.0;
+		float64_t basis = 1.0;
+		float64_t dBasis = 0.0;
+		for (int32_t jdx = 0; jdx < 4; jdx++)
+		{
+			if (jdx == idx)
+			{
+				continue;
+			}
+			denom *= px[idx] - px[jdx];
+			dBasis = dBasis*(x - px[jdx]) + basis;
+			basis *= x - px[jdx];
+		}
+		*value += py[idx]*basis / denom;
+		*slope += py[idx]*dBasis / denom;
+	}
+	return;
+}
+
+/**
+* @brief build a monotone cubic hermite spline of the disortion curve, on
+*        uniform knots so that findRfromA is a constant time polynomial.
+*        knot radius and slope come from a local cubic through 4 curve
+*        points around the knot, slopes are limited so that the spline is
+*        monotone wherever the knots are. knots are added until the spline
+*        is as close to every curve point as the linear curve is between
+*        them, or within DEFAULT_SPLINE_TOLERANCE. the curve stays
+*        linear if that takes more memory than the curve itself. the
+*        spline is built on top of the curve, dRadius is kept as the one
+*        that is saved, fitted and resampled, findRfromA only reads sCoef
+* @param cam [in/out] camera model
+* @return success flag, CFALSE if the curve stays linear
+*/
+CFlags buildCurveSpline(CamInt* cam)
+{
+	cam->sCoef.reset();
+	cam->sCurveSize = 0;
+	cam->sStep = 0.0F;
+	int32_t curveSize = cam->dCurveSize;
+	if ((4*DEFAULT_SPLINE_SIZE > curveSize) || (0.0F != curveAngle(cam, 0)) || !(curveAngle(cam, curveSize - 1) > 0.0F))
+	{/* short curves are resampled chords, they are meant to be linear */
+		return CFALSE;
+	}
+	const float32_t* pRadius = cam->dRadius.data();
+	float64_t thetaEnd = curveAngle(cam, curveSize - 1)*DEG2RAD;
+
+	/* the linear curve is off by about a quarter of the miss of the chord
+	   over two segments, the spline has to do at least as well */
+	float64_t tolerance = DEFAULT_SPLINE_TOLERANCE;
+	for (int32_t idx = 1; idx < curveSize - 1; idx++)
+	{
+		float64_t a0 = curveAngle(cam, idx - 1);
+		float64_t frac = (curveAngle(cam, idx) - a0) / (curveAngle(cam, idx + 1) - a0);
+		float64_t chord = pRadius[idx - 1] + frac*(float64_t(pRadius[idx + 1]) - pRadius[idx - 1]);
+		tolerance = MAX(tolerance, 0.25*fabs(pRadius[idx] - chord));
+	}
+	std::vector<float64_t> knotRadius;
+	std::vector<float64_t> knotSlope;
+	for (int32_t knots = DEFAULT_SPLINE_SIZE; 4*knots <= curveSize; knots = 2*knots - 1)
+	{
+		float64_t step = thetaEnd / (knots - 1);
+		/* points a third of a knot apart, adjacent ones turn their rounding into slope noise */
+		int32_t stride = MAX((curveSize - 1) / (3*(knots - 1)), 1);
+		knotRadius.resize(knots);
+		knotSlope.resize(knots);
+		for (int32_t idx = 0; idx < knots; idx++)
+		{
+			float64_t theta = idx*step;
+			float32_t angle = float32_t(theta*(1.0 / DEG2RAD));
+			int32_t seg = cam->dAngle.empty() ? MIN(int32_t(angle / cam->dStep), curveSize - 2) : findAngleSegment(cam, angle);
+			int32_t first = MIN(MAX(seg - stride, 0), curveSize - 1 - 3*stride);
+			float64_t px[4];
+			float64_t py[4];
+			for (int32_t jdx = 0; jdx < 4; jdx++)
+			{
+				px[jdx] = curveAngle(cam, first + jdx*stride)*DEG2RAD;
+				py[jdx] = pRadius[first + jdx*stride];
+			}
+			lagrangeCubic(px, py, theta, &knotRadius[idx], &knotSlope[idx]);
+		}
+		knotRadius[0] = pRadius[0];
+		knotRadius[knots - 1] = pRadius[curveSize - 1];
+
+		cam->sCurveSize = knots;
+		cam->sStep = float32_t(step);
+		cam->sCoef.allocate(4*(knots - 1));
+		for (int32_t idx = 0; idx < knots - 1; idx++)
+		{/* fritsch-carlson, in units of the knot step */
+			float64_t r0 = knotRadius[idx];
+			float64_t r1 = knotRadius[idx + 1];
+			float64_t delta = r1 - r0;
+			float64_t d0 = knotSlope[idx]*step;
+			float64_t d1 = knotSlope[idx + 1]*step;
+			if (0.0 == delta)
+			{
+				d0 = 0.0;
+				d1 = 0.0;
+			}
+			else
+			{
+				d0 = (d0*delta < 0.0) ? 0.0 : d0;
+				d1 = (d1*delta < 0.0) ? 0.0 : d1;
+				float64_t a = d0 / delta;
+				float64_t b = d1 / delta;
+				if (a*a + b*b > 9.0)
+				{
+					float64_t scale = 3.0 / sqrt(a*a + b*b);
+					d0 *= scale;
+					d1 *= scale;
+				}
+			}
+			float32_t* c = cam->sCoef.data() + 4*idx;
+			c[0] = float32_t(r0);
+			c[1] = float32_t(d0);
+			c[2] = float32_t(3.0*delta - 2.0*d0 - d1);
+			c[3] = float32_t(-2.0*delta + d0 + d1);
+		}
+
+		float32_t errMax = 0.0F;
+		for (int32_t idx = 0; idx < curveSize; idx++)
+		{
+			float32_t theta = float32_t(curveAngle(cam, idx)*DEG2RAD);
+			errMax = MAX(errMax, fabsf(findRfromA(theta, cam) - pRadius[idx]));
+		}
+		if (errMax <= tolerance)
+		{
+			CLOG_I(2, "Curve spline of %d knots, max error %e mm, linear %e mm\n", knots, errMax, tolerance);
+			return CTRUE;
+		}
+		CLOG_I(2, "Curve spline of %d knots, max error %e mm, linear %e mm, too large\n", knots, errMax, tolerance);
+		cam->sCoef.reset();
+		cam->sCurveSize = 0;
+		cam->sStep = 0.0F;
+	}
+	return CFALSE;
+}
+
+/**
+* @brief resample the disortion curve to fewer knots, picked from its
+*        points so that the new curve is within tolerance of the old one
+*        everywhere. each knot is the farthest point whose chord from the
+*        last knot passes all points between them, so nearly linear parts
+*        get long segments and bends keep their points. builds the
+*        inverse curve and the angle guide of the new curve
+* @param cam       [in/out] camera model
+* @param tolerance [in]     max radius error, in mm
+* @return success flag
+*/
+CFlags resampleCurve(CamInt* cam, float32_t tolerance)
+{
+	if (cam->dRadius.empty() || (cam->dCurveSize < 2) || !(tolerance >= 0.0F))
+	{
+		CLOG_E("Could not resample disortion curve, size %d, tolerance %f\n", cam->dCurveSize, tolerance);
+		return CFALSE;
+	}
+	CurveBuffer angle2Keep(cam->dCurveSize);
+	CurveBuffer radius2Keep(cam->dCurveSize);
+	int32_t knotSize = 0;
+	int32_t idxKnot = 0;
+	angle2Keep[knotSize] = curveAngle(cam, 0);
+	radius2Keep[knotSize] = cam->dRadius[0];
+	knotSize++;
+	while (idxKnot < cam->dCurveSize - 1)
+	{
+		/* slopes from the knot that pass every point so far, within tolerance */
+		float64_t a0 = curveAngle(cam, idxKnot);
+		float64_t r0 = cam->dRadius[idxKnot];
+		float64_t slopeLow = -HUGE_VAL;
+		float64_t slopeHigh = HUGE_VAL;
+		int32_t idxNext = idxKnot + 1;
+		for (int32_t idx = idxKnot + 1; idx < cam->dCurveSize; idx++)
+		{
+			float64_t da = curveAngle(cam, idx) - a0;
+			float64_t dr = cam->dRadius[idx] - r0;
+			float64_t slope = dr / da;
+			if ((slope < slopeLow) || (slope > slopeHigh))
+			{
+				break;
+			}
+			idxNext = idx;
+			slopeLow = MAX(slopeLow, (dr - tolerance) / da);
+			slopeHigh = MIN(slopeHigh, (dr + tolerance) / da);
+		}
+		idxKnot = idxNext;
+		angle2Keep[knotSize] = curveAngle(cam, idxKnot);
+		radius2Keep[knotSize] = cam->dRadius[idxKnot];
+		knotSize++;
+	}
+	CLOG_I(2, "Disortion curve resampled from %d to %d knots, tolerance %f mm\n", cam->dCurveSize, knotSize, tolerance);
+
+	/* copy to buffers of the knot size, the curve is kept small */
+	cam->dCurveSize = knotSize;
+	cam->dAngle.reset();
+	cam->dRadius.reset();
+	cam->dAngle.allocate(knotSize);
+	cam->dRadius.allocate(knotSize);
+	memcpy(cam->dAngle.data(), angle2Keep.data(), knotSize*sizeof(float32_t));
+	memcpy(cam->dRadius.data(), radius2Keep.data(), knotSize*sizeof(float32_t));
+	dropUniformAngles(cam);
+	cam->rLut.reset();
+	return buildRadiusLut(cam);
+}
@@ -6,10 +6,21 @@
 * Description: Load config file
 */
 #include "config.h"
-#include <fstream>
-#include <sstream>
 #include <memory.h>
 
+/* value of omitted config terms */
+static const configData emptyCfgValue;
+
+/**
+* Whitespace between config words, same set as reading words from a stream
+* @param c [in] character
+* @return true if c separates words
+*/
+static inline bool isCfgSpace(char c)
+{
+    return (' ' == c) || ('\t' == c) || ('\n' == c) || ('\v' == c) || ('\f' == c) || ('\r' == c);
+}
+
 /**
 * Constructor, load config and save to vConfigBank
 * @return no return
@@ -80,7 +91,8 @@ CONFIG_RET_CHECK CONFIG::getConfigGroup(configGroupElem& cfgGroup, int idx)
 }
 
 /**
-* Load config file and printf necessary messages
+* Load config file and printf necessary messages, the file is mapped and
+* split into words in place, config values point into the mapping
 * @param  configPath      [in] full path to the config file
 * @return standard return check
 */
@@ -91,59 +103,79 @@ CONFIG_RET_CHECK CONFIG::loadConfig(const char *configPath)
     cfgTemp.name = sGroupName;
     cfgTemp.necessary = configLoadNecessary;
     cfgTemp.iCntConfig = 0;
-    ifstream configFile(configPath);
-    if ((REQUIRED == configLoadNecessary) && (configFile.fail()))
+    shared_ptr<MappedFile> configFile = make_shared<MappedFile>(configPath);
+    if ((REQUIRED == configLoadNecessary) && (!configFile->isOpen()))
     {
         ret = CONFIG_RET_FAIL;
         printf("Load config { %s } failed\n", configPath);
     }
-    else if ((OMIT_WITH_WARNING == configLoadNecessary) && (configFile.fail()))
+    else if ((OMIT_WITH_WARNING == configLoadNecessary) && (!configFile->isOpen()))
     {
         ret = CONFIG_RET_SUCCESS;
-        vConfigBank.iCntGroup++;
-        vConfigBank.vConfigGroup.push_back(cfgTemp);
+        addConfigGroup(cfgTemp);
         printf("Load config { %s } failed, omit --- \n", configPath);
     }
-    else if ((OMIT == configLoadNecessary) && (configFile.fail()))
+    else if ((OMIT == configLoadNecessary) && (!configFile->isOpen()))
     {
-        vConfigBank.iCntGroup++;
-        vConfigBank.vConfigGroup.push_back(cfgTemp);
+        addConfigGroup(cfgTemp);
         ret = CONFIG_RET_SUCCESS;
     }
 	else
 	{
-		string line;
 		configElem cfgElemTemp;
 		int finishFlag = 0;
-		while (getline(configFile, line))
+		const char* pos = configFile->data();
+		const char* fileEnd = pos + configFile->size();
+		while (pos < fileEnd)
 		{ // loop to load lines from config file
-			for (int idx = 0; idx < vLineCommentSymbol.size(); idx++)
+			const char* lineEnd = (const char*)memchr(pos, '\n', fileEnd - pos);
+			lineEnd = (NULL == lineEnd) ? fileEnd : lineEnd;
+			string_view line(pos, lineEnd - pos);
+			pos = (lineEnd < fileEnd) ? lineEnd + 1 : fileEnd;
+
+			size_t equalPos = line.find_first_of('=');
+			for (int idx = 0; (string_view::npos != equalPos) && (idx < vLineCommentSymbol.size()); idx++)
 			{
-				if (line.find_first_of("=") < line.find_first_of(vLineCommentSymbol[idx].c_str()))
+				if (equalPos < line.find_first_of(vLineCommentSymbol[idx]))
 				{/* if this line contains valid information split by "=" */
 					finishFlag = 1;
 					/* save current buffer */
-					cfgTemp.vConfigList.push_back(cfgElemTemp);
+					cfgTemp.vConfigList.push_back(std::move(cfgElemTemp));
 					cfgTemp.iCntConfig++;
 					/* start a new config term */
-					cfgElemTemp.configValue.data.clear();
+					cfgElemTemp.configValue.clear();
 					cfgElemTemp.configName.clear();
 					break;
 				}
 			}
 			/* split line to words */
-			stringstream phraseBuffer;phraseBuffer << line;
-			string phrase;
-			vector<string> data;
-			
-			int commentFlag = 0;
+			size_t rowBegin = cfgElemTemp.configValue.data.size();
 			int iCnt = 0;
-			while (phraseBuffer >> phrase)
+			size_t wordEnd = 0;
+			while (wordEnd < line.size())
 			{/* for each word */
+				size_t wordBegin = wordEnd;
+				while ((wordBegin < line.size()) && isCfgSpace(line[wordBegin]))
+				{
+					wordBegin++;
+				}
+				if (wordBegin == line.size())
+				{
+					break;
+				}
+				wordEnd = wordBegin;
+				while ((wordEnd < line.size()) && !isCfgSpace(line[wordEnd]))
+				{
+					wordEnd++;
+				}
+				string_view phrase = line.substr(wordBegin, wordEnd - wordBegin);
+
 				/* judge if it is a comment */
+				int commentFlag = 0;
 				for (int idx = 0; idx < vLineCommentSymbol.size(); idx++)
 				{
-					if (0 == strcmp((phrase.substr(0, vLineCommentSymbol[idx].size())).c_str(), vLineCommentSymbol[idx].c_str()))
+					if ((phrase[0] == vLineCommentSymbol[idx][0]) &&
+						(0 == phrase.compare(0, vLineCommentSymbol[idx].size(), vLineCommentSymbol[idx])))
 					{
 						commentFlag = 1;
 						break;
@@ -158,56 +190,81 @@ CONFIG_RET_CHECK CONFIG::loadConfig(const char *configPath)
 				{/* if it is the first phrase (possible the config name )*/
 					if (1 == finishFlag)
 					{/* and we are starting a new config term */
-						cfgElemTemp.configName = phrase;
+						cfgElemTemp.configName = string(phrase);
 					}
 					else
 					{/* this line contains data for last config term */
-						data.push_back(phrase);
+						cfgElemTemp.configValue.data.push_back(phrase);
 					}
 					finishFlag = 0;
 				}
 				else if (phrase != "=")
 				{
-					data.push_back(phrase);
+					cfgElemTemp.configValue.data.push_back(phrase);
 				}
 			}
-			if (data.size()>0)
+			if (cfgElemTemp.configValue.data.size() > rowBegin)
 			{
-				cfgElemTemp.configValue.data.push_back(data);
+				cfgElemTemp.configValue.rowEnd.push_back(cfgElemTemp.configValue.data.size());
 			}
-			
 		}
 		/* save config */
-		cfgTemp.vConfigList.push_back(cfgElemTemp);
+		cfgTemp.vConfigList.push_back(std::move(cfgElemTemp));
 		cfgTemp.iCntConfig++;
-		vConfigBank.iCntGroup++;
-		vConfigBank.vConfigGroup.push_back(cfgTemp);
-		configFile.close();
+		cfgTemp.file = configFile;
+		addConfigGroup(cfgTemp);
 	}
 	return ret;
 }
 /**
+* Index config names of a loaded group and append it to config bank
+* @param cfgGroup [in] loaded config group, moved into config bank
+* @return void return
+*/
+void CONFIG::addConfigGroup(configGroupElem& cfgGroup)
+{
+    cfgGroup.index.clear();
+    for (int cfgId = 0; cfgId < (int)cfgGroup.vConfigList.size(); cfgId++)
+    {
+        cfgGroup.index.emplace(cfgGroup.vConfigList[cfgId].configName, cfgId);
+    }
+    vConfigBank.index.emplace(cfgGroup.name, vConfigBank.iCntGroup);
+    vConfigBank.iCntGroup++;
+    vConfigBank.vConfigGroup.push_back(std::move(cfgGroup));
+    return;
+}
+/**
 * Find config group in config bank
 * @param vConfigList [out] found config group
 * @param groupName   [in]  target group name
 * @return standard return check
 */
 CONFIG_RET_CHECK CONFIG::findConfigGroup(vector<configElem>& vConfigList, const char* groupName)
+{
+    const configGroupElem* cfgGroup = NULL;
+    CONFIG_RET_CHECK ret = findConfigGroup(cfgGroup, groupName);
+    if (NULL != cfgGroup)
+    {
+        vConfigList = cfgGroup->vConfigList;
+    }
+    return ret;
+}
+/**
+* Find config group in config bank without copying it
+* @param cfgGroup  [out] found config group, NULL if it is omitted
+* @param groupName [in]  target group name
+* @return standard return check
+*/
+CONFIG_RET_CHECK CONFIG::findConfigGroup(const configGroupElem*& cfgGroup, const char* groupName)
 {
     CONFIG_RET_CHECK ret = CONFIG_RET_FAIL;
     int flagGroupExist = 0;
-    for(int groupId = 0; groupId < vConfigBank.iCntGroup;groupId++)
+    cfgGroup = NULL;
+    unordered_map<string, int>::const_iterator it = vConfigBank.index.find(groupName);
+    if (it != vConfigBank.index.end())
     {
-        if(0 == vConfigBank.vConfigGroup[groupId].name.compare(groupName))
-        {
-            flagGroupExist = 1;
-            vConfigList = vConfigBank.vConfigGroup[groupId].vConfigList;
-            break;
-        }
-        else
-        {
-            continue;
-        }
+        flagGroupExist = 1;
+        cfgGroup = &vConfigBank.vConfigGroup[it->second];
     }
     if ((0 == flagGroupExist) && (REQUIRED == configLoadNecessary))
     {
@@ -230,6 +287,54 @@ CONFIG_RET_CHECK CONFIG::findConfigGroup(vector<configElem>& vConfigList, const
     return ret;
 }
 /**
+* Look up config value in config bank without copying it, the values
+* point into the mapped config file and stay valid as long as the bank
+* @param cfgValue  [out] config values in string, empty if the term is omitted
+* @param cfgName   [in]  target cfg name
+* @param cfgGroup  [in]  config group name
+* @return standard return check
+*/
+CONFIG_RET_CHECK CONFIG::findCfgString(const configData*& cfgValue, const char *cfgName, const char *cfgGroup)
+{
+	CONFIG_RET_CHECK ret = CONFIG_RET_FAIL;
+	const configGroupElem* group = NULL;
+	cfgValue = &emptyCfgValue;
+	ret = findConfigGroup(group, cfgGroup);
+	if (CONFIG_RET_SUCCESS == ret)
+	{/* if we found target config group, then we try to find target config term */
+		unsigned int matchFlag = 0;
+		if (NULL != group)
+		{
+			unordered_map<string, int>::const_iterator it = group->index.find(cfgName);
+			if (it != group->index.end())
+			{/* found target config term */
+				matchFlag = 1;
+				cfgValue = &group->vConfigList[it->second].configValue;
+			}
+		}
+		/* Could not locate target config term */
+		if ((0 == matchFlag) && (REQUIRED == configLoadNecessary))
+        {
+			ret = CONFIG_RET_FAIL;
+			printf("Could not find config term [%s], failed -- \n", cfgName);
+		}
+		else if ((0 == matchFlag) && (OMIT_WITH_WARNING == configLoadNecessary))
+		{
+			ret = CONFIG_RET_SUCCESS;
+			printf("Could not find config term [%s], omit -- \n", cfgName);
+		}
+		else if ((0 == matchFlag) && (OMIT == configLoadNecessary))
+		{
+			ret = CONFIG_RET_SUCCESS;
+		}
+		else
+		{
+			ret = CONFIG_RET_SUCCESS;
+		}
+	}
+    return ret;
+}
+/**
 * Check whether one config term's value equals to someting
 * @param cfgName  	[in] config term name
 * @param cfgCheck   [in] target config check name
@@ -239,9 +344,9 @@ CONFIG_RET_CHECK CONFIG::findConfigGroup(vector<configElem>& vConfigList, const
 CONFIG_RET_CHECK CONFIG::checkCfgValue(const char *cfgName, const char *cfgCheck,const char *cfgGroup)
 {
     CONFIG_RET_CHECK ret = CONFIG_RET_FAIL;
-    vector<vector<string>> test;
-    ret = extCfgString(test,cfgName,cfgGroup);
-    if(test[0][0] == cfgCheck)
+    const configData* test = NULL;
+    ret = findCfgString(test,cfgName,cfgGroup);
+    if(!test->empty() && !(*test)[0].empty() && (*test)[0][0] == cfgCheck)
     {
         ret = CONFIG_RET_SUCCESS;
     }
@@ -265,47 +370,18 @@ CONFIG_RET_CHECK CONFIG::checkCfgValue(const char *cfgName, const char *cfgCheck
 CONFIG_RET_CHECK CONFIG::extCfgString(vector<vector<string>>& cfgValue, const char *cfgName, const char *cfgGroup)
 {
 	CONFIG_RET_CHECK ret = CONFIG_RET_FAIL;
-	vector<configElem> vConfigList;
-	ret = findConfigGroup(vConfigList, cfgGroup);
+	const configData* value = NULL;
+	ret = findCfgString(value, cfgName, cfgGroup);
 	if (CONFIG_RET_SUCCESS == ret)
-	{/* if we found target config group, then we try to find target config term */
-		unsigned int matchFlag = 0;
-		for (int cfgId = 0; cfgId < vConfigList.size(); cfgId++)
+	{
+		for (size_t rowId = 0; rowId < value->size(); rowId++)
 		{
-			string cfgNameS = cfgName;
-			if (0 == vConfigList[cfgId].configName.compare(cfgName))
-			{/* found target config term */
-				matchFlag = 1;
-				for (int rowId = 0; rowId < vConfigList[cfgId].configValue.data.size(); rowId++)
-				{/* read config value from the buffer */
-					vector<string> col;
-					for (int colId = 0; colId < vConfigList[cfgId].configValue.data[rowId].size(); colId++)
-					{
-						col.push_back(vConfigList[cfgId].configValue.data[rowId][colId]);
-					}
-					cfgValue.push_back(col);
-				}
-	    		break;
+			vector<string> col;
+			for (size_t colId = 0; colId < (*value)[rowId].size(); colId++)
+			{
+				col.push_back(string((*value)[rowId][colId]));
 			}
-		}
-		/* Could not locate target config term */
-		if ((0 == matchFlag) && (REQUIRED == configLoadNecessary))
-        {
-			ret = CONFIG_RET_FAIL;
-			printf("Could not find config term [%s], failed -- \n", cfgName);
-		}
-		else if ((0 == matchFlag) && (OMIT_WITH_WARNING == configLoadNecessary))
-		{
-			ret = CONFIG_RET_SUCCESS;
-			printf("Could not find config term [%s], omit -- \n", cfgName);
-		}
-		else if ((0 == matchFlag) && (OMIT == configLoadNecessary))
-		{
-			ret = CONFIG_RET_SUCCESS;
-		}
-		else
-		{
-			ret = CONFIG_RET_SUCCESS;
+			cfgValue.push_back(col);
 		}
 	}
     return ret;
@@ -1,159 +1,174 @@
 #include "matrix.h"
+#include "simd.h"
+#include "ThreadPool.h"
 #include <iomanip> 
+#include <cmath>
+#include <charconv>
+#include <climits>
+#include <cstdint>
 
 using std::ifstream;
 using std::ofstream;
-using std::istringstream;
 using std::cerr;
 using std::endl;
 
-const Matrix operator+(const Matrix& lhs, const float rhs)
+//---------------------------------------------------
+//      blocked kernels shared by the large matrix ops
+//---------------------------------------------------
+#define GEMM_MR         (4)                     // rows of a C tile held in registers
+#define GEMM_NR         (2 * SIMD_WIDTH_F64)    // cols of a C tile held in registers
+#define GEMM_MC         (64)                    // rows of A per block, one task each
+#define GEMM_KC         (128)                   // depth of a block, an MC x KC block of A stays in L2
+#define GEMM_NC         (128)                   // cols of B per block, a KC x NC panel of B stays in L2
+#define MATRIX_TILE     (32)                    // transpose tile
+#define MATRIX_TRANS_MIN (64 * 64)              // elements up to which trans is a plain loop
+#define MATRIX_MT_WORK  (1 << 21)               // multiply-adds above which row blocks run on the pool
+
+// thread pool shared by the large matrix ops, started on first use
+static ThreadPool* matrixPool()
 {
-    Matrix ret;
-    if (lhs.empty())
-    {
-        return ret;
-    }
-    else
-    {
-        ret = lhs;
-        int r = ret.rows();
-        int c = ret.cols();
-
-        for (int i = 0; i < r; ++i)
-        {
-            for (int j = 0; j < c; ++j)
-            {
-                ret[i][j] += rhs;
-            }
-        }
-        return ret;
-    }
+    static ThreadPool pool;
+    return &pool;
 }
 
-const Matrix operator+(const float rhs, const Matrix& lhs)
+// run body(i0, i1) over rows [0, n) in blocks of `block` rows,
+// the blocks run on the shared pool when `work` is large enough
+template <typename Func>
+static void parallelRows(int n, int block, double work, const Func& body)
 {
-    Matrix ret;
-    if (lhs.empty())
+    int nTasks = (n + block - 1) / block;
+    if (nTasks > 1 && work >= MATRIX_MT_WORK && matrixPool()->size() > 1)
     {
-        return ret;
+        matrixPool()->parallelFor(nTasks, [&](int32_t t)
+        {
+            body(t * block, (t + 1) * block < n ? (t + 1) * block : n);
+        });
+        return;
     }
-    else
-    {
-        ret = lhs;
-        int r = ret.rows();
-        int c = ret.cols();
 
-        for (int i = 0; i < r; ++i)
-        {
-            for (int j = 0; j < c; ++j)
-            {
-                ret[i][j] += rhs;
-            }
-        }
-        return ret;
+    for (int t = 0; t < nTasks; ++t)
+    {
+        body(t * block, (t + 1) * block < n ? (t + 1) * block : n);
     }
 }
 
-const Matrix operator-(const Matrix& lhs, const float rhs)
+// y[0:n] += a * x[0:n]
+inline static void axpyRow(double* y, const double* x, double a, int n)
 {
-    Matrix ret;
-    if (lhs.empty())
+    const vf64 va = vdSet1(a);
+    int k = 0;
+    for (; k + SIMD_WIDTH_F64 <= n; k += SIMD_WIDTH_F64)
     {
-        return ret;
+        vdStore(y + k, vdFmadd(va, vdLoad(x + k), vdLoad(y + k)));
     }
-    else
+    for (; k < n; ++k)
     {
-        ret = lhs;
-        int r = ret.rows();
-        int c = ret.cols();
-
-        for (int i = 0; i < r; ++i)
-        {
-            for (int j = 0; j < c; ++j)
-            {
-                ret[i][j] -= rhs;
-            }
-        }
-        return ret;
+        y[k] += a * x[k];
     }
 }
 
-const Matrix operator*(const Matrix& lhs, const float rhs)
+// C[0:MR][0:NR] += A[0:MR][0:K] * B[0:K][0:NR], the C tile stays in registers
+inline static void gemmKernel(const double* A, int lda, const double* B, int ldb, double* C, int ldc, int K)
 {
-    Matrix ret;
-    if (lhs.empty())
+    const int W = SIMD_WIDTH_F64;
+    double* C1 = C + ldc;
+    double* C2 = C1 + ldc;
+    double* C3 = C2 + ldc;
+    vf64 c00 = vdLoad(C),  c01 = vdLoad(C + W);
+    vf64 c10 = vdLoad(C1), c11 = vdLoad(C1 + W);
+    vf64 c20 = vdLoad(C2), c21 = vdLoad(C2 + W);
+    vf64 c30 = vdLoad(C3), c31 = vdLoad(C3 + W);
+
+    for (int k = 0; k < K; ++k)
     {
-        return ret;
+        const double* b = B + (size_t)k * ldb;
+        const vf64 b0 = vdLoad(b);
+        const vf64 b1 = vdLoad(b + W);
+        vf64 a = vdSet1(A[k]);
+        c00 = vdFmadd(a, b0, c00);
+        c01 = vdFmadd(a, b1, c01);
+        a = vdSet1(A[lda + k]);
+        c10 = vdFmadd(a, b0, c10);
+        c11 = vdFmadd(a, b1, c11);
+        a = vdSet1(A[2 * lda + k]);
+        c20 = vdFmadd(a, b0, c20);
+        c21 = vdFmadd(a, b1, c21);
+        a = vdSet1(A[3 * lda + k]);
+        c30 = vdFmadd(a, b0, c30);
+        c31 = vdFmadd(a, b1, c31);
     }
-    else
-    {
-        ret = lhs;
 
-        int r = ret.rows();
-        int c = ret.cols();
-
-        for (int i = 0; i < r; ++i)
-        {
-            for (int j = 0; j < c; ++j)
-            {
-                ret[i][j] *= rhs;
-            }
-        }
-        return ret;
-    }
+    vdStore(C, c00);  vdStore(C + W, c01);
+    vdStore(C1, c10); vdStore(C1 + W, c11);
+    vdStore(C2, c20); vdStore(C2 + W, c21);
+    vdStore(C3, c30); vdStore(C3 + W, c31);
 }
 
-const Matrix operator*(const float rhs, const Matrix& lhs)
+// single row version of gemmKernel for the last rows of a block
+inline static void gemmKernelRow(const double* A, const double* B, int ldb, double* C, int K)
 {
-    Matrix ret;
-    if (lhs.empty())
+    const int W = SIMD_WIDTH_F64;
+    vf64 c0 = vdLoad(C), c1 = vdLoad(C + W);
+
+    for (int k = 0; k < K; ++k)
     {
-        return ret;
+        const double* b = B + (size_t)k * ldb;
+        const vf64 a = vdSet1(A[k]);
+        c0 = vdFmadd(a, vdLoad(b), c0);
+        c1 = vdFmadd(a, vdLoad(b + W), c1);
     }
-    else
-    {
-        ret = lhs;
-
-        int r = ret.rows();
-        int c = ret.cols();
 
-        for (int i = 0; i < r; ++i)
-        {
-            for (int j = 0; j < c; ++j)
-            {
-                ret[i][j] *= rhs;
-            }
-        }
-        return ret;
-    }
+    vdStore(C, c0);
+    vdStore(C + W, c1);
 }
-const Matrix operator/(const Matrix& lhs, const float rhs)
+
+// C[i0:i1] += A[i0:i1] * B
+// rows are padded to MATRIX_ALIGN bytes, a multiple of GEMM_NR, so the
+// column loop runs over whole tiles and only touches the zero padding
+static void gemmRows(const Matrix& A, const Matrix& B, Matrix& C, int i0, int i1)
 {
-    Matrix ret;
-    if (lhs.empty())
-    {
-        return ret;
-    }
-    else
-    {
-        ret = lhs;
-        int r = ret.rows();
-        int c = ret.cols();
+    const int K = A.cols();
+    const int N = (C.cols() + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    const int lda = A.stride();
+    const int ldb = B.stride();
+    const int ldc = C.stride();
 
-        for (int i = 0; i < r; ++i)
+    for (int kb = 0; kb < K; kb += GEMM_KC)
+    {
+        const int kc = (K - kb < GEMM_KC) ? (K - kb) : GEMM_KC;
+        for (int jb = 0; jb < N; jb += GEMM_NC)
         {
-            for (int j = 0; j < c; ++j)
+            const int je = (jb + GEMM_NC < N) ? (jb + GEMM_NC) : N;
+            int i = i0;
+            for (; i + GEMM_MR <= i1; i += GEMM_MR)
             {
-                ret[i][j] /= rhs;
+                for (int j = jb; j < je; j += GEMM_NR)
+                {
+                    gemmKernel(A[i] + kb, lda, B[kb] + j, ldb, C[i] + j, ldc, kc);
+                }
+            }
+            for (; i < i1; ++i)
+            {
+                for (int j = jb; j < je; j += GEMM_NR)
+                {
+                    gemmKernelRow(A[i] + kb, B[kb] + j, ldb, C[i] + j, kc);
+                }
             }
         }
-        return ret;
     }
 }
 
+// C += A * B, C is sized A.rows() x B.cols()
+static void gemm(const Matrix& A, const Matrix& B, Matrix& C)
+{
+    double work = double(C.rows()) * C.cols() * A.cols();
+    parallelRows(C.rows(), GEMM_MC, work, [&](int i0, int i1)
+    {
+        gemmRows(A, B, C, i0, i1);
+    });
+}
 
-const Matrix& Matrix::operator=(int* a)
+Matrix& Matrix::operator=(int* a)
 {
     if (empty())
     {
@@ -166,16 +181,17 @@ const Matrix& Matrix::operator=(int* a)
 
         for (int i = 0; i < r; ++i)
         {
+            double* dst = (*this)[i];
             for (int j = 0; j < c; ++j)
             {
-                array[i][j] = a[i*c + j];
+                dst[j] = a[i*c + j];
             }
         }
         return *this;
     }
 }
 
-const Matrix& Matrix::operator=(float* a)
+Matrix& Matrix::operator=(float* a)
 {
     if (empty())
     {
@@ -188,16 +204,17 @@ const Matrix& Matrix::operator=(float* a)
 
         for (int i = 0; i < r; ++i)
         {
+            double* dst = (*this)[i];
             for (int j = 0; j < c; ++j)
             {
-                array[i][j] = a[i*c + j];
+                dst[j] = a[i*c + j];
             }
         }
         return *this;
     }
 }
 
-const Matrix& Matrix::operator=(double* a)
+Matrix& Matrix::operator=(double* a)
 {
     if (empty())
     {
@@ -210,16 +227,17 @@ const Matrix& Matrix::operator=(double* a)
 
         for (int i = 0; i < r; ++i)
         {
+            double* dst = (*this)[i];
             for (int j = 0; j < c; ++j)
             {
-                array[i][j] = a[i*c + j];
+                dst[j] = a[i*c + j];
             }
         }
         return *this;
     }
 }
 
-const Matrix& Matrix::operator=(const Matrix& m)
+Matrix& Matrix::operator=(const Matrix& m)
 {
     if (empty() == 0 && (rows() != m.rows() || cols() != m.cols()))
     {
@@ -229,19 +247,28 @@ const Matrix& Matrix::operator=(const Matrix& m)
     int r = m.rows();
     int c = m.cols();
 
+    if (this == &m) return *this;
     if (empty()) resize(r, c);
 
     for (int i = 0; i < r; ++i)
     {
-        for (int j = 0; j < c; ++j)
-        {
-            array[i][j] = m[i][j];
-        }
+        memcpy((*this)[i], m[i], c * sizeof(double));
     }
     return *this;
 }
 
-const Matrix& Matrix::operator+=(const Matrix& m)
+Matrix& Matrix::operator=(Matrix&& m)
+{
+    if (empty() == 0 && (rows() != m.rows() || cols() != m.cols()))
+    {
+        return *this;
+    }
+
+    MATRIX<double>::operator=(std::move(m));
+    return *this;
+}
+
+Matrix& Matrix::operator+=(const Matrix& m)
 {
     if (rows() != m.rows() || cols() != m.cols())
     {
@@ -253,9 +280,11 @@ const Matrix& Matrix::operator+=(const Matrix& m)
 
     for (int i = 0; i < r; ++i)
     {
+        double* dst = (*this)[i];
+        const double* src = m[i];
         for (int j = 0; j < c; ++j)
         {
-            array[i][j] += m[i][j];
+            dst[j] += src[j];
         }
     }
 
@@ -263,7 +292,7 @@ const Matrix& Matrix::operator+=(const Matrix& m)
 }
 
 
-const Matrix& Matrix::operator-=(const Matrix& m)
+Matrix& Matrix::operator-=(const Matrix& m)
 {
     if (rows() != m.rows() || cols() != m.cols())
     {
@@ -275,16 +304,18 @@ const Matrix& Matrix::operator-=(const Matrix& m)
 
     for (int i = 0; i < r; ++i)
     {
+        double* dst = (*this)[i];
+        const double* src = m[i];
         for (int j = 0; j < c; ++j)
         {
-            array[i][j] -= m[i][j];
+            dst[j] -= src[j];
         }
     }
 
     return *this;
 }
 
-const Matrix& Matrix::operator*=(const Matrix& m)
+Matrix& Matrix::operator*=(const Matrix& m)
 {
     if (cols() != m.rows() || !m.square())
     {
@@ -293,30 +324,28 @@ const Matrix& Matrix::operator*=(const Matrix& m)
 
     Matrix ret(rows(), cols());
 
-    int r = rows();
-    int c = cols();
-
-    for (int i = 0; i < r; ++i)
-    {
-        for (int j = 0; j < c; ++j)
-        {
-            double sum = 0.0;
-            for (int k = 0; k < c; ++k)
-            {
-                sum += array[i][k] * m[k][j];
-            }
-            ret[i][j] = sum;
-        }
-    }
+    gemm(*this, m, ret);
 
     *this = ret;
     return *this;
 }
 
-const Matrix& Matrix::operator/=(const Matrix& m)
+Matrix& Matrix::operator/=(const Matrix& m)
 {
-    Matrix tmp = inverse(m);
-    return operator*=(tmp);
+    if (cols() != m.rows() || !m.square())
+    {
+        return *this;
+    }
+
+    // X * m = this, solved transposed as m^T * X^T = this^T
+    Matrix t = ::solve(trans(m), trans(*this));
+    if (t.empty())
+    {
+        return *this;
+    }
+
+    *this = trans(t);
+    return *this;
 }
 
 
@@ -346,35 +375,22 @@ bool operator!=(const Matrix& lhs, const Matrix& rhs)
     return !(lhs == rhs);
 }
 
-const Matrix operator+(const Matrix& lhs, const Matrix& rhs)
+Matrix operator*(const Matrix& lhs, const Matrix& rhs)
 {
     Matrix m;
-    if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+    if (lhs.cols() != rhs.rows())
     {
         return m;
     }
 
-    m = lhs;
-    m += rhs;
-
-    return m;
-}
-
-const Matrix operator-(const Matrix& lhs, const Matrix& rhs)
-{
-    Matrix m;
-    if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
-    {
-        return m;
-    }
+    m.resize(lhs.rows(), rhs.cols());
 
-    m = lhs;
-    m -= rhs;
+    gemm(lhs, rhs, m);
 
     return m;
 }
 
-const Matrix operator*(const Matrix& lhs, const Matrix& rhs)
+Matrix operator/(const Matrix& lhs, const Matrix& rhs)
 {
     Matrix m;
     if (lhs.cols() != rhs.rows())
@@ -382,39 +398,14 @@ const Matrix operator*(const Matrix& lhs, const Matrix& rhs)
         return m;
     }
 
-    m.resize(lhs.rows(), rhs.cols());
-
-    int r = m.rows();
-    int c = m.cols();
-    int K = lhs.cols();
-
-    for (int i = 0; i < r; ++i)
-    {
-        for (int j = 0; j < c; ++j)
-        {
-            double sum = 0.0;
-            for (int k = 0; k < K; ++k)
-            {
-                sum += lhs[i][k] * rhs[k][j];
-            }
-            m[i][j] = sum;
-        }
-    }
-
-    return m;
-}
-
-const Matrix operator/(const Matrix& lhs, const Matrix& rhs)
-{
-    Matrix tmp = inverse(rhs);
-    Matrix m;
-
-    if (tmp.empty())
+    // X * rhs = lhs, solved transposed as rhs^T * X^T = lhs^T
+    Matrix t = solve(trans(rhs), trans(lhs));
+    if (t.empty())
     {
         return m;
     }
 
-    return m = lhs * tmp;
+    return m = trans(t);
 }
 
 inline static double LxAbs(double d)
@@ -422,29 +413,6 @@ inline static double LxAbs(double d)
     return (d >= 0) ? (d) : (-d);
 }
 
-inline
-static bool isSignRev(const vector<double>& v)
-{
-    int p = 0;
-    int sum = 0;
-    int n = (int)v.size();
-
-    for (int i = 0; i < n; ++i)
-    {
-        p = (int)v[i];
-        if (p >= 0)
-        {
-            sum += p + i;
-        }
-    }
-
-    if (sum % 2 == 0) // �����ż����˵�������
-    {
-        return false;
-    }
-    return true;
-}
-
 // ���㷽������ʽ
 const double det(const Matrix& m)
 {
@@ -452,22 +420,7 @@ const double det(const Matrix& m)
 
     if (m.empty() || !m.square()) return ret;
 
-    Matrix N = LU(m);
-
-    if (N.empty()) return ret;
-
-    ret = 1.0;
-    for (int i = 0; i < N.cols(); ++i)
-    {
-        ret *= N[i][i];
-    }
-
-    if (isSignRev(N[N.rows() - 1]))
-    {
-        return -ret;
-    }
-
-    return ret;
+    return LUDecomp(m).det();
 }
 
 // �������ָ���ӷ��������ʽ 
@@ -478,7 +431,7 @@ const double det(const Matrix& m, int start, int end)
 
 
 // �������ת��
-const Matrix trans(const Matrix& m)
+Matrix trans(const Matrix& m)
 {
     Matrix ret;
     if (m.empty()) return ret;
@@ -487,19 +440,49 @@ const Matrix trans(const Matrix& m)
     int c = m.rows();
 
     ret.resize(r, c);
-    for (int i = 0; i < r; ++i)
+
+    const int ss = m.stride();
+    const int ds = ret.stride();
+    const double* src = m[0];
+    double* dst = ret[0];
+
+    // small matrices are in cache anyway, tiles only add loop overhead
+    if ((double)r * c <= MATRIX_TRANS_MIN)
     {
-        for (int j = 0; j < c; ++j)
+        for (int i = 0; i < r; ++i)
         {
-            ret[i][j] = m[j][i];
+            for (int j = 0; j < c; ++j)
+            {
+                dst[(size_t)i * ds + j] = src[(size_t)j * ss + i];
+            }
         }
+        return ret;
     }
 
+    // MATRIX_TILE x MATRIX_TILE tiles, both the reads and the writes stay in cache,
+    // each tile writes MATRIX_TILE contiguous elements per destination row
+    parallelRows(r, MATRIX_TILE, double(r) * c, [&](int i0, int i1)
+    {
+        for (int j0 = 0; j0 < c; j0 += MATRIX_TILE)
+        {
+            int j1 = (j0 + MATRIX_TILE < c) ? (j0 + MATRIX_TILE) : c;
+            for (int i = i0; i < i1; ++i)
+            {
+                double* d = dst + (size_t)i * ds;
+                const double* s = src + i;
+                for (int j = j0; j < j1; ++j)
+                {
+                    d[j] = s[(size_t)j * ss];
+                }
+            }
+        }
+    });
+
     return ret;
 }
 
 // ���������
-const Matrix  inverse(const Matrix& m)
+Matrix  inverse(const Matrix& m)
 {
     Matrix ret;
 
@@ -540,32 +523,32 @@ const Matrix  inverse(const Matrix& m)
             ret.swap_row(j, p);
         }
 
+        const double* Aj = A[j];
+        const double* Rj = ret[j];
         double d = A[j][j];
         for (int i = j; i < n; ++i) A[j][i] /= d;
         for (int i = 0; i < n; ++i) ret[j][i] /= d;
 
-        for (int i = 0; i < n; ++i)
+        // the row updates of one pivot are independent
+        parallelRows(n, GEMM_MC, double(n) * n * n, [&](int i0, int i1)
         {
-            if (i != j)
+            for (int i = i0; i < i1; ++i)
             {
-                double q = A[i][j];
-                for (int k = j; k < n; ++k)
+                if (i != j)
                 {
-                    A[i][k] -= q * A[j][k];
-                }
-                for (int k = 0; k < n; ++k)
-                {
-                    ret[i][k] -= q * ret[j][k];
+                    double q = A[i][j];
+                    axpyRow(A[i] + j, Aj + j, -q, n - j);
+                    axpyRow(ret[i], Rj, -q, n);
                 }
             }
-        }
+        });
     }
 
     return ret;
 }
 
 // �������ֵ
-const Matrix abs(const Matrix& m)
+Matrix abs(const Matrix& m)
 {
     Matrix ret;
 
@@ -705,7 +688,7 @@ const double sum(const Matrix& m)
 }
 
 // ȡ������ָ��λ�õ��Ӿ��� 
-const Matrix submatrix(const Matrix& m, int rb, int re, int cb, int ce)
+Matrix submatrix(const Matrix& m, int rb, int re, int cb, int ce)
 {
     Matrix ret;
     if (m.empty()) return ret;
@@ -745,7 +728,7 @@ int max_idx(const Matrix& m, int k, int n)
 // ����LΪ�Խ���Ԫ��ȫΪ1����������UΪ�Խ�Ԫ������M����������
 // ʹ�� M = LU
 // ���ؾ��������ǲ��ִ洢L(�Խ�Ԫ�س���)�������ǲ��ִ洢U(�����Խ���Ԫ��)
-const Matrix LU(const Matrix& m)
+Matrix LU(const Matrix& m)
 {
     Matrix ret;
 
@@ -761,10 +744,7 @@ const Matrix LU(const Matrix& m)
 
     for (int i = 0; i < n; ++i)
     {
-        for (int j = 0; j < n; ++j)
-        {
-            ret[i][j] = m[i][j];
-        }
+        memcpy(ret[i], m[i], n * sizeof(double));
     }
 
     for (int k = 0; k < n - 1; ++k)
@@ -783,12 +763,14 @@ const Matrix LU(const Matrix& m)
             return ret;
         }
 
+        const double* Uk = ret[k];
         for (int i = k + 1; i < n; ++i)
         {
-            ret[i][k] /= ret[k][k];
+            double* Li = ret[i];
+            Li[k] /= Uk[k];
             for (int j = k + 1; j < n; ++j)
             {
-                ret[i][j] -= ret[i][k] * ret[k][j];
+                Li[j] -= Li[k] * Uk[j];
             }
         }
     }
@@ -796,69 +778,393 @@ const Matrix LU(const Matrix& m)
     return ret;
 }
 
+// LU decomposition with partial pivoting, P * M = L * U
+bool LUDecomp::compute(const Matrix& m)
+{
+    lu.resize(0, 0);
+    perm.clear();
+    sign = 1;
+
+    if (m.empty() || !m.square()) return false;
+
+    int n = m.rows();
+    lu = m;
+    perm.resize(n);
+    for (int i = 0; i < n; ++i) perm[i] = i;
+
+    for (int k = 0; k < n; ++k)
+    {
+        int p = max_idx(lu, k, n);
+        if (LxAbs(lu[p][k]) < 1e-20)
+        {
+            lu.resize(0, 0);
+            perm.clear();
+            return false;
+        }
+
+        if (p != k)
+        {
+            lu.swap_row(k, p);
+            int t = perm[k];
+            perm[k] = perm[p];
+            perm[p] = t;
+            sign = -sign;
+        }
+
+        const double* Uk = lu[k];
+        for (int i = k + 1; i < n; ++i)
+        {
+            double* Li = lu[i];
+            Li[k] /= Uk[k];
+            axpyRow(Li + k + 1, Uk + k + 1, -Li[k], n - k - 1);
+        }
+    }
+
+    return true;
+}
+
+// solve M * X = B, each row operation updates all right-hand sides at once
+Matrix LUDecomp::solve(const Matrix& B) const
+{
+    Matrix X;
+    if (!ok() || B.rows() != lu.rows()) return X;
+
+    int n = lu.rows();
+    int c = B.cols();
+    X.resize(n, c);
+
+    for (int i = 0; i < n; ++i)
+    {
+        memcpy(X[i], B[perm[i]], c * sizeof(double));
+    }
+
+    // L * Y = P * B, L has unit diagonal
+    for (int i = 1; i < n; ++i)
+    {
+        const double* Li = lu[i];
+        double* Xi = X[i];
+        for (int k = 0; k < i; ++k)
+        {
+            axpyRow(Xi, X[k], -Li[k], c);
+        }
+    }
+
+    // U * X = Y
+    for (int i = n - 1; i >= 0; --i)
+    {
+        const double* Ui = lu[i];
+        double* Xi = X[i];
+        for (int k = i + 1; k < n; ++k)
+        {
+            axpyRow(Xi, X[k], -Ui[k], c);
+        }
+        const double d = Ui[i];
+        for (int j = 0; j < c; ++j) Xi[j] /= d;
+    }
+
+    return X;
+}
+
+const double LUDecomp::det() const
+{
+    if (!ok()) return 0.0;
+
+    double ret = sign;
+    for (int i = 0; i < lu.rows(); ++i) ret *= lu[i][i];
+    return ret;
+}
+
+Matrix LUDecomp::inverse() const
+{
+    if (!ok()) return Matrix();
+    return solve(eye(lu.rows()));
+}
+
+// Cholesky decomposition M = L * L^T, rows of L are contiguous so both
+// sums below are dot products of two rows
+bool CholeskyDecomp::compute(const Matrix& m)
+{
+    L.resize(0, 0);
+
+    if (m.empty() || !m.square()) return false;
+
+    int n = m.rows();
+    L.resize(n, n);
+
+    for (int j = 0; j < n; ++j)
+    {
+        double* Lj = L[j];
+        double d = m[j][j];
+        for (int k = 0; k < j; ++k) d -= Lj[k] * Lj[k];
+        if (!(d > 0.0))
+        {
+            L.resize(0, 0);
+            return false;
+        }
+        Lj[j] = sqrt(d);
+
+        for (int i = j + 1; i < n; ++i)
+        {
+            double* Li = L[i];
+            double s = m[i][j];
+            for (int k = 0; k < j; ++k) s -= Li[k] * Lj[k];
+            Li[j] = s / Lj[j];
+        }
+    }
+
+    return true;
+}
+
+// solve M * X = B by L * Y = B then L^T * X = Y
+Matrix CholeskyDecomp::solve(const Matrix& B) const
+{
+    Matrix X;
+    if (!ok() || B.rows() != L.rows()) return X;
+
+    int n = L.rows();
+    int c = B.cols();
+    X = B;
+
+    for (int i = 0; i < n; ++i)
+    {
+        const double* Li = L[i];
+        double* Xi = X[i];
+        for (int k = 0; k < i; ++k)
+        {
+            axpyRow(Xi, X[k], -Li[k], c);
+        }
+        const double d = Li[i];
+        for (int j = 0; j < c; ++j) Xi[j] /= d;
+    }
+
+    for (int i = n - 1; i >= 0; --i)
+    {
+        double* Xi = X[i];
+        for (int k = i + 1; k < n; ++k)
+        {
+            axpyRow(Xi, X[k], -L[k][i], c);
+        }
+        const double d = L[i][i];
+        for (int j = 0; j < c; ++j) Xi[j] /= d;
+    }
+
+    return X;
+}
+
+// solve A * X = B, empty if A is singular
+Matrix solve(const Matrix& A, const Matrix& B)
+{
+    return LUDecomp(A).solve(B);
+}
+
+// solve A * X = B for symmetric positive definite A, falls back to LU
+// when the Cholesky decomposition breaks down
+Matrix solveSPD(const Matrix& A, const Matrix& B)
+{
+    CholeskyDecomp chol(A);
+    if (chol.ok()) return chol.solve(B);
+    return solve(A, B);
+}
+
 //---------------------------------------------------
 //                      ��ȡ�ʹ�ӡ
 //---------------------------------------------------
-// ����������ȡ����
-const Matrix readMatrix(istream& in)
+// text matrices, one row per line, numbers separated by spaces, tabs,
+// ',' or ';'. lines without numbers are skipped, any other character,
+// a malformed number or rows of different length fail the read
+#define MATRIX_READ_CHUNK       (1 << 20)       // bytes per read of a stream
+#define MATRIX_READ_MT_BYTES    (1 << 22)       // file size above which chunks parse on the pool
+
+// parse the numbers of one line into row
+inline static bool parseMatrixLine(const char* p, const char* end, vector<double>& row)
 {
-    Matrix M;
-    string str;
-    double b;
-    vector<double> v;
+    row.clear();
+    while (p < end)
+    {
+        char ch = *p;
+        if (ch == ' ' || ch == '\t' || ch == ',' || ch == ';' || ch == '\r')
+        {
+            ++p;
+            continue;
+        }
+        if (ch != '-' && ch != '.' && (ch < '0' || ch > '9'))
+        {
+            return false;
+        }
+
+        double v;
+        std::from_chars_result ret = std::from_chars(p, end, v);
+        if (ret.ec != std::errc())
+        {
+            return false;
+        }
+        row.push_back(v);
+        p = ret.ptr;
+    }
+    return true;
+}
 
-    while (getline(in, str))
+// parse the complete lines of [p, end) into M, p is left at the start of
+// the unfinished last line, which is parsed too if last is set.
+// rowHint rows are allocated with the first row, so M grows only past it
+static bool parseMatrixLines(const char*& p, const char* end, bool last, int rowHint,
+    Matrix& M, vector<double>& row)
+{
+    while (p < end)
     {
-        for (string::size_type i = 0; i < str.size(); ++i)
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        if (nl == NULL)
+        {
+            if (!last) break;
+            nl = end;
+        }
+
+        if (!parseMatrixLine(p, nl, row))
+        {
+            return false;
+        }
+        if (!row.empty())
         {
-            if (str[i] == ',' || str[i] == ';')
+            if (M.empty() && rowHint > 0)
             {
-                str[i] = ' ';
+                M.resize(rowHint, (int)row.size());
+                M.resize(0, (int)row.size());
             }
-            else if (str[i] != '.' && (str[i] < '0' || str[i] > '9')
-                && str[i] != ' ' && str[i] != '\t' && str[i] != '-')
+            if (!M.push_back(row))
             {
-                M.resize(0, 0);
-                return M;
+                return false;
             }
         }
+        p = (nl < end) ? nl + 1 : end;
+    }
+    return true;
+}
 
-        istringstream sstream(str);
-        v.resize(0);
+// number of lines in [p, end), an upper bound of the rows
+static int countLines(const char* p, const char* end)
+{
+    size_t n = (p < end) ? 1 : 0;
+    while ((p = (const char*)memchr(p, '\n', end - p)) != NULL && ++p < end)
+    {
+        ++n;
+    }
+    return (n < INT_MAX) ? (int)n : INT_MAX;
+}
+
+// ����������ȡ����
+// the stream is read in MATRIX_READ_CHUNK blocks, a line split by the
+// block end is carried over to the next block
+Matrix readMatrix(istream& in)
+{
+    Matrix M;
+    vector<char> buf(MATRIX_READ_CHUNK);
+    vector<double> row;
+    size_t keep = 0;        // bytes of the unfinished line at the front of buf
 
-        while (sstream >> b)
+    for (;;)
+    {
+        if (keep == buf.size())
         {
-            v.push_back(b);
+            buf.resize(2 * buf.size());     // a line longer than the buffer
         }
-        if (v.size() == 0)
+        in.read(&buf[keep], buf.size() - keep);
+        size_t n = keep + (size_t)in.gcount();
+        bool last = !in;
+
+        const char* p = buf.data();
+        const char* end = p + n;
+        if (!parseMatrixLines(p, end, last, 0, M, row))
         {
-            continue;
+            return Matrix();
         }
-        if (!M.push_back(v))
+        if (last)
         {
-            M.resize(0, 0);
-            return M;
+            break;
         }
+
+        keep = end - p;
+        memmove(buf.data(), p, keep);
     }
 
     return M;
 }
 
 // ���ı��ļ��������
-const Matrix readMatrix(string file)
+// the file is mapped and the rows are allocated from a line count up
+// front. large files are cut at line ends into one chunk per pool thread,
+// the chunks parse in parallel and are joined with one copy each
+Matrix readMatrix(string file)
 {
-    ifstream fin(file.c_str());
-    Matrix M;
-
-    if (!fin)
+    MappedFile f(file.c_str());
+    if (!f.isOpen())
     {
         cerr << "Error: open file " << file << " failed." << endl;
-        return M;
+        return Matrix();
+    }
+    if (f.size() == 0)
+    {
+        return Matrix();
+    }
+
+    const char* begin = f.data();
+    const char* end = begin + f.size();
+
+    int nChunks = (f.size() >= MATRIX_READ_MT_BYTES) ? (int)matrixPool()->size() : 1;
+    vector<const char*> cut(nChunks + 1, end);
+    cut[0] = begin;
+    for (int t = 1; t < nChunks; ++t)
+    {
+        const char* p = begin + f.size() / nChunks * t;
+        p = (p > cut[t - 1]) ? p : cut[t - 1];
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        cut[t] = (nl != NULL) ? nl + 1 : end;
+    }
+
+    vector<Matrix> parts(nChunks);
+    vector<char> ok(nChunks, 0);
+    parallelRows(nChunks, 1, (double)f.size(), [&](int t0, int t1)
+    {
+        vector<double> row;
+        for (int t = t0; t < t1; ++t)
+        {
+            const char* p = cut[t];
+            ok[t] = parseMatrixLines(p, cut[t + 1], true, countLines(cut[t], cut[t + 1]), parts[t], row);
+        }
+    });
+
+    if (nChunks == 1)
+    {
+        return ok[0] ? std::move(parts[0]) : Matrix();
     }
 
-    M = readMatrix(fin);
-    fin.close();
+    int rows = 0;
+    int cols = 0;
+    for (int t = 0; t < nChunks; ++t)
+    {
+        if (!ok[t] || (!parts[t].empty() && cols != 0 && parts[t].cols() != cols))
+        {
+            return Matrix();
+        }
+        if (!parts[t].empty())
+        {
+            cols = parts[t].cols();
+            rows += parts[t].rows();
+        }
+    }
 
+    Matrix M;
+    if (rows == 0)
+    {
+        return M;
+    }
+    M.resize(rows, cols);
+    int r = 0;
+    for (int t = 0; t < nChunks; ++t)
+    {
+        if (parts[t].empty()) continue;
+        memcpy(M[r], parts[t][0], (size_t)parts[t].rows() * M.stride() * sizeof(double));
+        r += parts[t].rows();
+    }
     return M;
 }
 
@@ -910,6 +1216,82 @@ void printMatrix(const Matrix& m, string file)
     fout.close();
 }
 
+//---------------------------------------------------
+// binary matrix file, version 1
+//   MatrixFileHeader, 64 bytes
+//   rows x stride doubles from dataOffset, rows padded with zeros
+// rows start MATRIX_ALIGN aligned in the file as in Matrix, so a mapped
+// file is used in place. numbers are in the byte order of the saving host,
+// byteOrder tells a reader whether to swap
+// legacy files are "MATRIX_DATA", rows and cols as int, rows x cols doubles
+//---------------------------------------------------
+#define MATRIX_FILE_MAGIC       "MATRIX_MMAP"
+#define MATRIX_FILE_LEGACY      "MATRIX_DATA"
+#define MATRIX_FILE_VERSION     (1)
+#define MATRIX_BYTE_ORDER       (0x01020304u)
+
+struct MatrixFileHeader
+{
+    char     magic[12];         // MATRIX_FILE_MAGIC
+    uint32_t version;           // MATRIX_FILE_VERSION
+    uint32_t byteOrder;         // MATRIX_BYTE_ORDER in the byte order of the file
+    uint32_t elemSize;          // sizeof(double)
+    int64_t  rows;
+    int64_t  cols;
+    int64_t  stride;            // elements per row
+    int64_t  dataOffset;        // bytes from the file start to row 0, multiple of MATRIX_ALIGN
+    char     reserved[8];
+};
+static_assert(sizeof(MatrixFileHeader) == 64, "MatrixFileHeader must be 64 bytes");
+
+template <typename T>
+inline static void swapBytes(T& v)
+{
+    char* p = (char*)&v;
+    for (size_t i = 0; i < sizeof(T) / 2; ++i)
+    {
+        char t = p[i];
+        p[i] = p[sizeof(T) - 1 - i];
+        p[sizeof(T) - 1 - i] = t;
+    }
+}
+
+// check the header of a mapped matrix file, swapped is set when the file
+// was written with the other byte order, the header is returned in host order
+static bool readMatrixHeader(const MappedFile& f, MatrixFileHeader& h, bool& swapped)
+{
+    if (f.size() < sizeof(MatrixFileHeader)) return false;
+
+    memcpy(&h, f.data(), sizeof(h));
+    if (memcmp(h.magic, MATRIX_FILE_MAGIC, sizeof(h.magic)) != 0) return false;
+
+    swapped = (h.byteOrder != MATRIX_BYTE_ORDER);
+    if (swapped)
+    {
+        swapBytes(h.version);
+        swapBytes(h.byteOrder);
+        swapBytes(h.elemSize);
+        swapBytes(h.rows);
+        swapBytes(h.cols);
+        swapBytes(h.stride);
+        swapBytes(h.dataOffset);
+        if (h.byteOrder != MATRIX_BYTE_ORDER) return false;
+    }
+
+    if (h.version < 1 || h.version > MATRIX_FILE_VERSION) return false;
+    if (h.elemSize != sizeof(double)) return false;
+    if (h.rows <= 0 || h.cols <= 0 || h.stride < h.cols) return false;
+    if (h.rows > INT_MAX || h.stride > INT_MAX) return false;
+    if (h.dataOffset < (int64_t)sizeof(h) || h.dataOffset % MATRIX_ALIGN != 0) return false;
+    if (h.dataOffset > (int64_t)f.size()) return false;
+
+    // rows * stride doubles must fit behind the header, checked without overflow
+    int64_t avail = ((int64_t)f.size() - h.dataOffset) / (int64_t)sizeof(double);
+    if (h.stride > avail / h.rows) return false;
+
+    return true;
+}
+
 // ���������ݴ�Ϊ�������ļ� 
 void saveMatrix(const Matrix& m, string file)
 {
@@ -918,63 +1300,144 @@ void saveMatrix(const Matrix& m, string file)
     ofstream fout(file.c_str(), std::ios_base::out | std::ios::binary);
     if (!fout) return;
 
-    int r = m.rows();
-    int c = m.cols();
-    char Flag[12] = "MATRIX_DATA";
-    fout.write((char*)&Flag, sizeof(Flag));
-    fout.write((char*)&r, sizeof(r));
-    fout.write((char*)&c, sizeof(c));
-
-    for (int i = 0; i < r; ++i)
-    {
-        for (int j = 0; j < c; ++j)
-        {
-            double t = m[i][j];
-            fout.write((char*)&t, sizeof(t));
-        }
-    }
+    MatrixFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MATRIX_FILE_MAGIC, sizeof(MATRIX_FILE_MAGIC));
+    h.version = MATRIX_FILE_VERSION;
+    h.byteOrder = MATRIX_BYTE_ORDER;
+    h.elemSize = sizeof(double);
+    h.rows = m.rows();
+    h.cols = m.cols();
+    h.stride = m.stride();
+    h.dataOffset = sizeof(h);
+
+    // rows are contiguous with their zero padding, one write for the whole matrix
+    fout.write((const char*)&h, sizeof(h));
+    fout.write((const char*)m[0], (std::streamsize)m.rows() * m.stride() * sizeof(double));
 
     fout.close();
 }
 
 // �Ӷ������ļ�load����
-const Matrix loadMatrix(string file)
+// the legacy "MATRIX_DATA" format is still read
+Matrix loadMatrix(string file)
 {
     Matrix m;
 
-    ifstream fin(file.c_str(), std::ios_base::in | std::ios::binary);
-    if (!fin) return m;
+    MappedFile f(file.c_str());
+    if (!f.isOpen()) return m;
 
-    char Flag[12];
-    fin.read((char*)&Flag, sizeof(Flag));
-
-    string str(Flag);
-    if (str != "MATRIX_DATA")
+    // legacy format, rows x cols doubles right after rows and cols
+    if (f.size() >= 12 + 2 * sizeof(int) && memcmp(f.data(), MATRIX_FILE_LEGACY, 12) == 0)
     {
+        int r, c;
+        memcpy(&r, f.data() + 12, sizeof(r));
+        memcpy(&c, f.data() + 12 + sizeof(r), sizeof(c));
+
+        if (r <= 0 || c <= 0) return m;
+
+        size_t ofs = 12 + 2 * sizeof(int);
+        if ((f.size() - ofs) / sizeof(double) / (size_t)c < (size_t)r) return m;
+
+        m.resize(r, c);
+        for (int i = 0; i < r; ++i)
+        {
+            memcpy(m[i], f.data() + ofs + (size_t)i * c * sizeof(double), c * sizeof(double));
+        }
         return m;
     }
 
-    int r, c;
-    fin.read((char*)&r, sizeof(r));
-    fin.read((char*)&c, sizeof(c));
+    MatrixFileHeader h;
+    bool swapped = false;
+    if (!readMatrixHeader(f, h, swapped)) return m;
 
-    if (r <= 0 || c <= 0) return m;
+    int r = (int)h.rows;
+    int c = (int)h.cols;
+    const char* src = f.data() + h.dataOffset;
+    size_t rowBytes = (size_t)h.stride * sizeof(double);
 
     m.resize(r, c);
-    double t;
+    if (!swapped && h.stride == m.stride())
+    {
+        memcpy(m[0], src, (size_t)r * rowBytes);
+        return m;
+    }
 
     for (int i = 0; i < r; ++i)
     {
-        for (int j = 0; j < c; ++j)
+        double* dst = m[i];
+        memcpy(dst, src + (size_t)i * rowBytes, c * sizeof(double));
+        if (swapped)
         {
-            fin.read((char*)&t, sizeof(t));
-            m[i][j] = t;
+            for (int j = 0; j < c; ++j) swapBytes(dst[j]);
         }
     }
-
     return m;
 }
 
+// map a binary file as a read only view, nothing is copied
+bool loadMatrix(string file, MatrixView& view)
+{
+    return view.open(file);
+}
+
+MatrixView::MatrixView(MatrixView&& v) noexcept
+    : file(std::move(v.file)), base(v.base), nRows(v.nRows), nCols(v.nCols), nStride(v.nStride)
+{
+    v.base = NULL;
+    v.nRows = 0;
+    v.nCols = 0;
+    v.nStride = 0;
+}
+
+MatrixView& MatrixView::operator=(MatrixView&& v) noexcept
+{
+    if (this != &v)
+    {
+        file = std::move(v.file);
+        base = v.base;
+        nRows = v.nRows;
+        nCols = v.nCols;
+        nStride = v.nStride;
+        v.base = NULL;
+        v.nRows = 0;
+        v.nCols = 0;
+        v.nStride = 0;
+    }
+    return *this;
+}
+
+// map a file written by saveMatrix, files in the other byte order or in
+// the legacy format can not be used in place and are rejected, loadMatrix
+// converts them
+bool MatrixView::open(string path)
+{
+    close();
+
+    MappedFile f(path.c_str());
+    if (!f.isOpen()) return false;
+
+    MatrixFileHeader h;
+    bool swapped = false;
+    if (!readMatrixHeader(f, h, swapped) || swapped) return false;
+
+    file = std::move(f);
+    base = (const double*)(file.data() + h.dataOffset);
+    nRows = (int)h.rows;
+    nCols = (int)h.cols;
+    nStride = (int)h.stride;
+    return true;
+}
+
+void MatrixView::close()
+{
+    file.close();
+    base = NULL;
+    nRows = 0;
+    nCols = 0;
+    nStride = 0;
+}
+
 void dispMat(const Matrix& mat)
 {
 	if (mat.empty() == true)
@@ -992,7 +1455,7 @@ void dispMat(const Matrix& mat)
     }
 }
 
-const Matrix zeros(int row, int col)
+Matrix zeros(int row, int col)
 {
     Matrix ret;
     ret.resize(row, col);
@@ -1006,7 +1469,7 @@ const Matrix zeros(int row, int col)
     return ret;
 }
 
-const Matrix eye(int dim)
+Matrix eye(int dim)
 {
     Matrix ret;
     ret.zeros(dim, dim);